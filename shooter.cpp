@@ -4,8 +4,43 @@
  * NOTES:
  * http://www.ummon.eu/Linux/API/Devices/framebuffer.html
  * 
- * TODOS:
- * - make dedicated canvas frame handler (currently the canvas frame is actually screen-sized)
+ * BUILD:
+ * g++ -O2 -pthread shooter.cpp -o shooter
+ * g++ -O2 -pthread -DSHOOTER_TRACE shooter.cpp -o shooter   with scope timers (see --trace)
+ * 
+ * USAGE:
+ * ./shooter                       run the game on /dev/fb0
+ * ./shooter --bench-flood [n]     time recursive vs span flood fill over n frames
+ * ./shooter --bench-kernels [n]   GB/s of the clear/present kernels (SHOOTER_KERNELS picks one)
+ * ./shooter --bench-lines [n]     lines/s of the checked vs clipped plotLine
+ * ./shooter --bench-projectiles [n]  update and draw cost of n bullets/bombs per frame
+ * ./shooter --bench-collisions [runs]  collision grid cost for 10k..100k entities
+ * ./shooter --bench-input [n]     latency of n mouse packets through a FIFO stand-in device
+ * ./shooter --bench-surfaces [n]  clear/present cost per surface backing (malloc .. hugetlb)
+ * ./shooter --bench-commands [n]  n primitives drawn immediately vs recorded and run per tile
+ * ./shooter --bench-primitives [--runs N] [--json FILE] [--baseline FILE] [--threshold PCT]
+ *                                 ns/pixel of each primitive at three sizes; JSON results,
+ *                                 compared against an earlier JSON file (default 10% threshold)
+ * ./shooter --bench N             run N game frames headless, print frame times and a checksum
+ * 
+ * OPTIONS:
+ * --backend fbdev|memory|file     where frames go (default fbdev, memory with --bench)
+ * --fb PATH                       fbdev device or fake framebuffer file
+ * --size WxH                      resolution of the memory/file framebuffer (fbdev uses the mode's)
+ * --bpp 16|24|32, --line-length BYTES  layout of the memory/file framebuffer
+ * --threads N                     render in N horizontal bands in parallel (default: all cores)
+ * --fps N                         frame rate cap, 0 = a frame as soon as each simulation tick is due
+ *                                 (default 60, the simulation rate)
+ * --vsync                         pace frames on the display's vblank (fbdev, if the driver can)
+ * --no-pipeline                   draw, composite and present in one pass instead of presenting
+ *                                 the previous frame on its own thread while the next is drawn
+ * --indexed                       draw the game on 8-bit palette-indexed canvases, expanded to
+ *                                 pixels when composited
+ * --pages 1|2                     screens in the memory/file framebuffer; fbdev double buffers
+ *                                 by panning whenever yres_virtual holds two screens
+ * --trace FILE                    write the timed scopes as Chrome trace_event JSON on exit
+ *                                 (SHOOTER_TRACE builds; they always print per-stage histograms)
+ * --mouse PATH                    mouse device or FIFO sending PS/2 packets (default /dev/input/mice)
  * 
  */
 
@@ -19,11 +54,24 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <termios.h>
+#include <poll.h>
+#include <signal.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include <string.h>
+#include <time.h>
+#include <errno.h>
 #include <vector>
 #include <cmath>
 #include <algorithm>
 #include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 #define min(X,Y) (((X) < (Y)) ? (X) : (Y))
 #define max(X,Y) (((X) > (Y)) ? (X) : (Y))
@@ -31,12 +79,29 @@
 
 /* SETTINGS ------------------------------------------------------------ */
 #define screenXstart 250
-#define screenX 1366
-#define screenY 768
 #define mouseSensitivity 1
+#define maxDirtyRects 16 // per frame; more get merged into the closest one
+#define maxOutlineVertices 24
+#define simulationHz 60 // game ticks per second; velocities are pixels per tick
+#define maxCatchUpTicks 5 // ticks simulated at most per frame
+#define maxProjectiles 4096 // bullets and bombs in flight
+#define projectileMargin 40 // projectiles die this far outside the canvas
+#define collisionCellSize 32
+#define inputRingSize 64 // mouse states between the input thread and the main loop
+#define mouseQuitPollMs 100 // longest the input thread waits before checking whether to stop
+#define hugePageSize (2 * 1024 * 1024)
+#define commandTileWidth 2048 // binning tiles of the command buffer: wide, since a primitive is replayed
+#define commandTileHeight 32   // in every tile it crosses; 32 rows of 1366 px (170 KB) stay in L2
+#define traceRingSize 65536 // timed scopes kept per thread with -DSHOOTER_TRACE
+#define renderSlots 3 // canvases in flight when pipelined: drawn, queued, presented
+#define layerTileWidth 64 // pixels per coverage flag of a layer; a tile is one row high
 
 using namespace std;
 
+// screen resolution: fbdev sets it from fb_var_screeninfo, headless backends from --size
+int screenX = 1366;
+int screenY = 768;
+
 /* TYPEDEFS ------------------------------------------------------------ */
 
 //RGB color
@@ -46,9 +111,40 @@ typedef struct s_rgb {
 	unsigned char b;
 } RGB;
 
-//Frame of RGBs
+//Rectangle, half-open: [x0,x1) x [y0,y1)
+typedef struct s_rect {
+	int x0;
+	int y0;
+	int x1;
+	int y1;
+} Rect;
+
+//Damage of a frame: what was drawn this frame and the frame before.
+typedef struct s_damage {
+	Rect prev[maxDirtyRects];
+	int prevCount;
+	Rect cur[maxDirtyRects];
+	int curCount;
+	long long pixelsTouched; // pixels cleared/copied through this damage
+	long long frames;
+} Damage;
+
+//Frame of packed pixels, row-major. Each pixel is a little-endian 32-bit
+//BGRX word, the same layout /dev/fb0 uses at 32bpp, so rows can be copied
+//straight to the framebuffer. An indexed frame (newIndexedFrame) instead
+//holds a byte per pixel, an index into the palette; lines, circles, spans,
+//fills and sprites draw on both, flood fills and layers only on BGRX.
 typedef struct s_frame {
-	RGB px[screenX][screenY];
+	uint32_t* px;
+	unsigned char* index; // indexed frames only; px is NULL then
+	int width;
+	int height;
+	int stride; // pixels per row in px, >= width
+	Rect clip; // drawing never touches pixels outside this
+	Damage* damage; // NULL: not tracked, always cleared/shown whole
+	int backing; // how px was allocated (SURFACE ALLOCATOR)
+	size_t mapped; // bytes mmap'd for px, 0 if it came from the heap
+	size_t bytes;
 } Frame;
 
 //Coordinate System
@@ -57,6 +153,29 @@ typedef struct s_coord {
 	int y;
 } Coord;
 
+//Point between pixels, for the coverage rasterizer; pixel (x,y) spans [x, x+1) x [y, y+1)
+typedef struct s_point {
+	float x;
+	float y;
+} Point;
+
+//Polygon edge for the scanline fill, covering scanlines [yTop, yBottom)
+typedef struct s_edge {
+	int yTop;
+	int yBottom;
+	int x;  // 16.16, at the current scanline (exact, rounded per side when filling)
+	int dx; // 16.16 per scanline
+} Edge;
+
+//Closed shape relative to its anchor, with its fill edges sorted by yTop
+typedef struct s_outline {
+	int count;
+	Coord vertex[maxOutlineVertices];
+	int edgeCount;
+	Edge edge[maxOutlineVertices];
+	Rect bounds;
+} Outline;
+
 //The integrated frame buffer plus info struct.
 typedef struct s_frameBuffer {
 	char* ptr;
@@ -77,6 +196,39 @@ Coord coord(int x, int y) {
 	return retval;
 }
 
+Point point(float x, float y) {
+	Point retval;
+	retval.x = x;
+	retval.y = y;
+	return retval;
+}
+
+// construct rect
+Rect rect(int x0, int y0, int x1, int y1) {
+	Rect retval;
+	retval.x0 = x0;
+	retval.y0 = y0;
+	retval.x1 = x1;
+	retval.y1 = y1;
+	return retval;
+}
+
+int isRectEmpty(Rect r) {
+	return r.x0 >= r.x1 || r.y0 >= r.y1;
+}
+
+long long rectArea(Rect r) {
+	return isRectEmpty(r) ? 0 : (long long)(r.x1 - r.x0) * (r.y1 - r.y0);
+}
+
+Rect rectUnion(Rect a, Rect b) {
+	return rect(min(a.x0, b.x0), min(a.y0, b.y0), max(a.x1, b.x1), max(a.y1, b.y1));
+}
+
+Rect rectIntersect(Rect a, Rect b) {
+	return rect(max(a.x0, b.x0), max(a.y0, b.y0), min(a.x1, b.x1), min(a.y1, b.y1));
+}
+
 unsigned char isInBound(Coord position, Coord corner1, Coord corner2) {
 	unsigned char xInBound = 0;
 	unsigned char yInBound = 0;
@@ -123,816 +275,4734 @@ Coord getCursorCoord(Coord* mc) {
 	return xy;
 }
 
-/* VIDEO OPERATIONS ---------------------------------------------------- */
+/* PIXEL KERNELS ------------------------------------------------------- */
 
-// construct RGB
-RGB rgb(unsigned char r, unsigned char g, unsigned char b) {
-	RGB retval;
-	retval.r = r;
-	retval.g = g;
-	retval.b = b;
-	return retval;
+// Row kernels behind clear and present. One variant is picked at startup
+// from what the CPU supports; SHOOTER_KERNELS=scalar|sse2|avx2 overrides it.
+typedef struct s_pixelKernels {
+	const char* name;
+	void (*fillRow)(uint32_t* dst, uint32_t px, int count);
+	void (*copyRow)(uint32_t* dst, const uint32_t* src, int count);
+	void (*convertRow)(uint32_t* dst, const uint32_t* src, int count); // BGRX -> BGRA, alpha forced to 255
+	void (*blendRow)(uint32_t* dst, const uint32_t* src, int count); // premultiplied BGRA src over dst
+	void (*expandRow)(uint32_t* dst, const unsigned char* src, int count, const uint32_t* palette); // indices -> BGRX
+} PixelKernels;
+
+void fillRowScalar(uint32_t* dst, uint32_t px, int count) {
+	for (int i = 0; i < count; i++) dst[i] = px;
 }
 
-// insert pixel to composition frame, with bounds filter
-void insertPixel(Frame* frm, Coord loc, RGB col) {
-	// do bounding check:
-	if (!(loc.x >= screenX || loc.x < 0 || loc.y >= screenY || loc.y < 0)) {
-		frm->px[loc.x][loc.y].r = col.r;
-		frm->px[loc.x][loc.y].g = col.g;
-		frm->px[loc.x][loc.y].b = col.b;
-	}
+void copyRowScalar(uint32_t* dst, const uint32_t* src, int count) {
+	for (int i = 0; i < count; i++) dst[i] = src[i];
 }
 
-// delete contents of composition frame
-void flushFrame (Frame* frm, RGB color) {
-	int x;
-	int y;
-	for (y=0; y<screenY; y++) {
-		for (x=0; x<screenX; x++) {
-			frm->px[x][y] = color;
-		}
-	}
+void convertRowScalar(uint32_t* dst, const uint32_t* src, int count) {
+	for (int i = 0; i < count; i++) dst[i] = src[i] | 0xFF000000u;
 }
 
-// copy composition Frame to FrameBuffer
-void showFrame (Frame* frm, FrameBuffer* fb) {
-	int x;
-	int y;
-	for (y=0; y<screenY; y++) {
-		for (x=0; x<screenX; x++) {
-			int location = x * (fb->bpp/8) + y * fb->lineLen;
-			*(fb->ptr + location    ) = frm->px[x][y].b; // blue
-			*(fb->ptr + location + 1) = frm->px[x][y].g; // green
-			*(fb->ptr + location + 2) = frm->px[x][y].r; // red
-			*(fb->ptr + location + 3) = 255; // transparency
-		}
+// also the SSE2 variant: without a gather, a table lookup per pixel is as good as it gets
+void expandRowScalar(uint32_t* dst, const unsigned char* src, int count, const uint32_t* palette) {
+	for (int i = 0; i < count; i++) dst[i] = palette[src[i]];
+}
+
+// x * y / 255, rounded; exact for all bytes, and what the SIMD blends compute per lane
+inline uint32_t mulDiv255(uint32_t x, uint32_t y) {
+	uint32_t t = x * y + 128;
+	return (t + (t >> 8)) >> 8;
+}
+
+/* every channel (alpha too) times alpha / 255: premultiplies a packed pixel,
+ * or fades a premultiplied one. mulDiv255 on two 16-bit lanes at a time.
+ */
+inline uint32_t scalePixel(uint32_t px, uint32_t alpha) {
+	uint32_t rb = (px & 0x00FF00FF) * alpha + 0x00800080;
+	uint32_t ga = ((px >> 8) & 0x00FF00FF) * alpha + 0x00800080;
+	rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+	ga = (ga + ((ga >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+	return rb | ga;
+}
+
+// premultiplied s over d, every channel (alpha too): s + d * (255 - alpha of s) / 255
+inline uint32_t blendPixel(uint32_t d, uint32_t s) {
+	uint32_t inverse = 255 - (s >> 24);
+	if (inverse == 255) return d;
+	return s + scalePixel(d, inverse); // no carries: each sum stays within its byte
+}
+
+void blendRowScalar(uint32_t* dst, const uint32_t* src, int count) {
+	for (int i = 0; i < count; i++) dst[i] = blendPixel(dst[i], src[i]);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/* The copy kernels write with streaming stores: their destination is the
+ * mapped framebuffer, which is never read back, so there's no point in
+ * pulling it through the cache.
+ */
+
+__attribute__((target("sse2")))
+void fillRowSSE2(uint32_t* dst, uint32_t px, int count) {
+	int i = 0;
+	__m128i v = _mm_set1_epi32(px);
+	for (; i < count && ((uintptr_t)(dst + i) & 15); i++) dst[i] = px;
+	for (; i + 4 <= count; i += 4) _mm_store_si128((__m128i*)(dst + i), v);
+	for (; i < count; i++) dst[i] = px;
+}
+
+__attribute__((target("sse2")))
+void streamRowSSE2(uint32_t* dst, const uint32_t* src, int count, uint32_t orMask) {
+	int i = 0;
+	__m128i mask = _mm_set1_epi32(orMask);
+	for (; i < count && ((uintptr_t)(dst + i) & 15); i++) dst[i] = src[i] | orMask;
+	for (; i + 4 <= count; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+		_mm_stream_si128((__m128i*)(dst + i), _mm_or_si128(v, mask));
 	}
+	for (; i < count; i++) dst[i] = src[i] | orMask;
+	_mm_sfence();
 }
 
-void showCanvas(Frame* frm, Frame* cnvs, int canvasWidth, int canvasHeight, Coord loc, RGB borderColor, int isBorder) {
-	int x, y;
-	for (y=0; y<canvasHeight;y++) {
-		for (x=0; x<canvasWidth; x++) {
-			insertPixel(frm, coord(loc.x - canvasWidth/2 + x, loc.y - canvasHeight/2 + y), cnvs->px[x][y]);
-		}
+__attribute__((target("sse2")))
+void copyRowSSE2(uint32_t* dst, const uint32_t* src, int count) {
+	streamRowSSE2(dst, src, count, 0);
+}
+
+__attribute__((target("sse2")))
+void convertRowSSE2(uint32_t* dst, const uint32_t* src, int count) {
+	streamRowSSE2(dst, src, count, 0xFF000000u);
+}
+
+// two pixels per 64-bit half as 16-bit lanes: s + d * (255 - alpha of s) / 255
+__attribute__((target("sse2")))
+inline __m128i blendLanesSSE2(__m128i s, __m128i d) {
+	__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+	__m128i t = _mm_add_epi16(_mm_mullo_epi16(d, _mm_sub_epi16(_mm_set1_epi16(255), alpha)), _mm_set1_epi16(128));
+	return _mm_add_epi16(s, _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8));
+}
+
+// plain stores: the destination is a canvas or composition frame that is read again
+__attribute__((target("sse2")))
+void blendRowSSE2(uint32_t* dst, const uint32_t* src, int count) {
+	int i = 0;
+	__m128i zero = _mm_setzero_si128();
+	for (; i + 4 <= count; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+		__m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+		__m128i lo = blendLanesSSE2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+		__m128i hi = blendLanesSSE2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
 	}
-	
-	//show border
-	if(isBorder){
-		for (y=0; y<canvasHeight; y++) {
-			insertPixel(frm, coord(loc.x - canvasWidth/2 - 1, loc.y - canvasHeight/2 + y), borderColor);
-			insertPixel(frm, coord(loc.x  - canvasWidth/2 + canvasWidth, loc.y - canvasHeight/2 + y), borderColor);
-		}
-		for (x=0; x<canvasWidth; x++) {
-			insertPixel(frm, coord(loc.x - canvasWidth/2 + x, loc.y - canvasHeight/2 - 1), borderColor);
-			insertPixel(frm, coord(loc.x - canvasWidth/2 + x, loc.y - canvasHeight/2 + canvasHeight), borderColor);
-		}
+	blendRowScalar(dst + i, src + i, count - i);
+}
+
+__attribute__((target("avx2")))
+void fillRowAVX2(uint32_t* dst, uint32_t px, int count) {
+	int i = 0;
+	__m256i v = _mm256_set1_epi32(px);
+	for (; i < count && ((uintptr_t)(dst + i) & 31); i++) dst[i] = px;
+	for (; i + 8 <= count; i += 8) _mm256_store_si256((__m256i*)(dst + i), v);
+	for (; i < count; i++) dst[i] = px;
+}
+
+__attribute__((target("avx2")))
+void streamRowAVX2(uint32_t* dst, const uint32_t* src, int count, uint32_t orMask) {
+	int i = 0;
+	__m256i mask = _mm256_set1_epi32(orMask);
+	for (; i < count && ((uintptr_t)(dst + i) & 31); i++) dst[i] = src[i] | orMask;
+	for (; i + 8 <= count; i += 8) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+		_mm256_stream_si256((__m256i*)(dst + i), _mm256_or_si256(v, mask));
 	}
+	for (; i < count; i++) dst[i] = src[i] | orMask;
+	_mm_sfence();
 }
 
-void addBlob(Frame* cnvs, Coord loc, RGB color) {
-	int x,y;
-	for (y=-2; y<3;y++) {
-		for (x=-2; x<3; x++) {
-			if (!(abs(x)==2 && abs(y)==2)) {
-				insertPixel(cnvs, coord(loc.x+x, loc.y+y), color);
-			}
-		}
+__attribute__((target("avx2")))
+void copyRowAVX2(uint32_t* dst, const uint32_t* src, int count) {
+	streamRowAVX2(dst, src, count, 0);
+}
+
+__attribute__((target("avx2")))
+void convertRowAVX2(uint32_t* dst, const uint32_t* src, int count) {
+	streamRowAVX2(dst, src, count, 0xFF000000u);
+}
+
+__attribute__((target("avx2")))
+inline __m256i blendLanesAVX2(__m256i s, __m256i d) {
+	__m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+	__m256i t = _mm256_add_epi16(_mm256_mullo_epi16(d, _mm256_sub_epi16(_mm256_set1_epi16(255), alpha)), _mm256_set1_epi16(128));
+	return _mm256_add_epi16(s, _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8));
+}
+
+// unpack and pack both work within 128-bit lanes, so pixel order comes back unchanged
+__attribute__((target("avx2")))
+void blendRowAVX2(uint32_t* dst, const uint32_t* src, int count) {
+	int i = 0;
+	__m256i zero = _mm256_setzero_si256();
+	for (; i + 8 <= count; i += 8) {
+		__m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+		__m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+		__m256i lo = blendLanesAVX2(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero));
+		__m256i hi = blendLanesAVX2(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero));
+		_mm256_storeu_si256((__m256i*)(dst + i), _mm256_packus_epi16(lo, hi));
 	}
+	blendRowScalar(dst + i, src + i, count - i);
 }
 
-	
-void plotCircle(Frame* frm,int xm, int ym, int r,RGB col)
-{
-   int x = -r, y = 0, err = 2-2*r; /* II. Quadrant */ 
-   do {
-      insertPixel(frm,coord(xm-x, ym+y),col); /*   I. Quadrant */
-      insertPixel(frm,coord(xm-y, ym-x),col); /*  II. Quadrant */
-      insertPixel(frm,coord(xm+x, ym-y),col); /* III. Quadrant */
-      insertPixel(frm,coord(xm+y, ym+x),col); /*  IV. Quadrant */
-      r = err;
-      if (r <= y) err += ++y*2+1;           /* e_xy+e_y < 0 */
-      if (r > x || err > y) err += ++x*2+1; /* e_xy+e_x > 0 or no 2nd y-step */
-   } while (x < 0);
+// eight indices widened to 32 bits, looked up with one gather; plain stores, dst is the composition frame
+__attribute__((target("avx2")))
+void expandRowAVX2(uint32_t* dst, const unsigned char* src, int count, const uint32_t* palette) {
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + i)));
+		_mm256_storeu_si256((__m256i*)(dst + i), _mm256_i32gather_epi32((const int*)palette, index, 4));
+	}
+	expandRowScalar(dst + i, src + i, count - i, palette);
 }
 
-void plotHalfCircle(Frame *frm,int xm, int ym, int r,RGB col)
-{
-   int x = -r, y = 0, err = 2-2*r; /* II. Quadrant */ 
-   do {
-      insertPixel(frm,coord(xm+x, ym-y),col); /* III. Quadrant */
-      insertPixel(frm,coord(xm+y, ym+x),col); /*  IV. Quadrant */
-      r = err;
-      if (r <= y) err += ++y*2+1;           /* e_xy+e_y < 0 */
-      if (r > x || err > y) err += ++x*2+1; /* e_xy+e_x > 0 or no 2nd y-step */
-   } while (x < 0);
+#endif
+
+// every variant this build has, best first; the last one is always scalar
+const PixelKernels kernelVariants[] = {
+#if defined(__x86_64__) || defined(__i386__)
+	{ "avx2", fillRowAVX2, copyRowAVX2, convertRowAVX2, blendRowAVX2, expandRowAVX2 },
+	{ "sse2", fillRowSSE2, copyRowSSE2, convertRowSSE2, blendRowSSE2, expandRowScalar },
+#endif
+	{ "scalar", fillRowScalar, copyRowScalar, convertRowScalar, blendRowScalar, expandRowScalar },
+};
+const int kernelVariantCount = sizeof(kernelVariants) / sizeof(kernelVariants[0]);
+
+int isKernelSupported(const PixelKernels* k) {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	if (strcmp(k->name, "avx2") == 0) return __builtin_cpu_supports("avx2");
+	if (strcmp(k->name, "sse2") == 0) return __builtin_cpu_supports("sse2");
+#endif
+	return 1;
 }
 
-/* Fungsi membuat garis */
-void plotLine(Frame* frm, int x0, int y0, int x1, int y1, RGB lineColor)
-{
-	int dx =  abs(x1-x0), sx = x0<x1 ? 1 : -1;
-	int dy = -abs(y1-y0), sy = y0<y1 ? 1 : -1; 
-	int err = dx+dy, e2; /* error value e_xy */
-	int loop = 1;
-	while(loop){  /* loop */
-		insertPixel(frm, coord(x0, y0), rgb(lineColor.r, lineColor.g, lineColor.b));
-		if (x0==x1 && y0==y1) loop = 0;
-		e2 = 2*err;
-		if (e2 >= dy) { err += dy; x0 += sx; } /* e_xy+e_x > 0 */
-		if (e2 <= dx) { err += dx; y0 += sy; } /* e_xy+e_y < 0 */
+PixelKernels selectPixelKernels() {
+	const char* wanted = getenv("SHOOTER_KERNELS");
+	int i;
+	for (i = 0; i < kernelVariantCount; i++) {
+		if (!isKernelSupported(&kernelVariants[i])) continue;
+		if (!wanted || strcmp(wanted, kernelVariants[i].name) == 0) return kernelVariants[i];
 	}
+	return kernelVariants[kernelVariantCount - 1];
 }
 
-void plotLineWidth(Frame* frm, int x0, int y0, int x1, int y1, float wd, RGB lineColor) { 
-	int dx = abs(x1-x0), sx = x0 < x1 ? 1 : -1; 
-	int dy = abs(y1-y0), sy = y0 < y1 ? 1 : -1; 
-	int err = dx-dy, e2, x2, y2;                          /* error value e_xy */
+PixelKernels kernels = selectPixelKernels();
 
-	float ed = dx+dy == 0 ? 1 : sqrt((float)dx*dx+(float)dy*dy);
+/* SURFACE ALLOCATOR --------------------------------------------------- */
 
-	for (wd = (wd+1)/2; ; ) {                                   /* pixel loop */
-		insertPixel(frm, coord(x0, y0), rgb(max(0,lineColor.r*(abs(err-dx+dy)/ed-wd+1)), 
-											max(0,lineColor.g*(abs(err-dx+dy)/ed-wd+1)), 
-											max(0,lineColor.b*(abs(err-dx+dy)/ed-wd+1))));
+/* Pixel memory for frames. Rows start 64-byte aligned (one cache line) and
+ * big surfaces are backed by huge pages where the system allows, so a full
+ * clear or present walks a few 2 MB TLB entries instead of ~750 4 KB ones.
+ * Each backing falls back to the next: hugetlbfs pages (only if some are
+ * reserved), transparent huge pages, plain aligned memory.
+ * SHOOTER_SURFACES=hugetlb|thp|aligned|malloc caps what is tried.
+ */
+enum { surfaceMalloc, surfaceAligned, surfaceTHP, surfaceHugeTLB, surfaceBackings };
+const char* surfaceBackingNames[surfaceBackings] = {"malloc", "aligned", "thp", "hugetlb"};
 
-		e2 = err; x2 = x0;
-		if (2*e2 >= -dx) {                                           /* x step */
-			for (e2 += dy, y2 = y0; e2 < ed*wd && (y1 != y2 || dx > dy); e2 += dx)
-				y2 += sy;
-				insertPixel(frm, coord(x0, y2), rgb(max(0,lineColor.r*(abs(e2)/ed-wd+1)), 
-															max(0,lineColor.g*(abs(e2)/ed-wd+1)), 
-															max(0,lineColor.b*(abs(e2)/ed-wd+1)))); 
-			if (x0 == x1) break;
-			e2 = err; err -= dy; x0 += sx; 
-		} 
-		
-		if (2*e2 <= dy) {                                            /* y step */
-			for (e2 = dx-e2; e2 < ed*wd && (x1 != x2 || dx < dy); e2 += dy)
-				x2 += sx;
-				insertPixel(frm, coord(x2, y0), rgb(max(0,lineColor.r*(abs(e2)/ed-wd+1)), 
-															max(0,lineColor.g*(abs(e2)/ed-wd+1)), 
-															max(0,lineColor.b*(abs(e2)/ed-wd+1)))); 
-			if (y0 == y1) break;
-			err += dx; y0 += sy; 
-		}
+typedef struct s_surfaceStats {
+	long long allocations[surfaceBackings]; // by backing actually used
+	long long liveBytes;
+	long long peakBytes;
+} SurfaceStats;
+
+SurfaceStats surfaceStats;
+
+int defaultSurfaceBacking() {
+	const char* name = getenv("SHOOTER_SURFACES");
+	for (int i = 0; name && i < surfaceBackings; i++) {
+		if (strcmp(name, surfaceBackingNames[i]) == 0) return i;
 	}
+	return surfaceHugeTLB;
 }
 
-void drawCannon(Frame* frm,Coord loc,RGB color){
-	plotLine(frm,loc.x-10,loc.y-10,loc.x-10,loc.y+30,color);
-	plotLine(frm,loc.x-10,loc.y+30,loc.x+10,loc.y+30,color);
-	plotLine(frm,loc.x+10,loc.y+30,loc.x+10,loc.y-10,color);
-	plotLine(frm,loc.x+10,loc.y-10,loc.x-10,loc.y-10,color);	
-	plotHalfCircle(frm,loc.x,loc.y-10,10,color);
-	loc.y=loc.y-20;
-	plotLine(frm,loc.x-5,loc.y-5,loc.x-5,loc.y+2,color);
-	//plotLine(loc.x-5,loc.y+5,loc.x+5,loc.y+5);
-	plotLine(frm,loc.x+5,loc.y+2,loc.x+5,loc.y-5,color);
-	plotLine(frm,loc.x+5,loc.y-5,loc.x-5,loc.y-5,color);	
+int surfaceBacking = defaultSurfaceBacking();
+
+// pixels per row: whole cache lines, and never a multiple of 4 KB so rows don't alias in the cache sets
+int surfaceStride(int width, int pixelBytes = sizeof(uint32_t)) {
+	int line = 64 / pixelBytes;
+	int stride = (width + line - 1) & ~(line - 1);
+	if (stride * pixelBytes % 4096 == 0) stride += line;
+	return stride;
 }
 
+/* Allocate bytes with the best backing up to *backing; *backing and
+ * *mapped (bytes to give back) say what was used. NULL if out of memory.
+ */
+void* allocSurface(size_t bytes, int* backing, size_t* mapped) {
+	void* p;
+	size_t huge = (bytes + hugePageSize - 1) & ~(size_t)(hugePageSize - 1);
+	if (bytes < hugePageSize && *backing > surfaceAligned) *backing = surfaceAligned; // not worth a huge page
 
-void drawStickman(Frame* frm,Coord loc,int sel,RGB color,int counter){
-	plotCircle(frm,loc.x,loc.y,15,color);
-	plotLine(frm,loc.x,loc.y+15,loc.x,loc.y+50,color);
-	
-	if(counter % 2 == 0){
-		plotLine(frm,loc.x,loc.y+30,loc.x+20,loc.y+sel-3,color);
-		plotLine(frm,loc.x,loc.y+30,loc.x+25,loc.y+(sel+10)-3,color);
-	}else{
-		plotLine(frm,loc.x,loc.y+30,loc.x+20,loc.y+sel,color);
-		plotLine(frm,loc.x,loc.y+30,loc.x+25,loc.y+(sel+10),color);
+#ifdef MAP_HUGETLB
+	if (*backing == surfaceHugeTLB) {
+		p = mmap(NULL, huge, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (p != MAP_FAILED) {
+			*mapped = huge;
+			return p;
+		}
 	}
-	
-	
+#endif
+	if (*backing >= surfaceTHP) {
+		// over-map by one huge page and trim, so the surface starts on a 2 MB boundary
+		char* raw = (char*)mmap(NULL, huge + hugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (raw != MAP_FAILED) {
+			char* start = (char*)(((uintptr_t)raw + hugePageSize - 1) & ~(uintptr_t)(hugePageSize - 1));
+			if (start > raw) munmap(raw, start - raw);
+			munmap(start + huge, raw + hugePageSize - start);
+#ifdef MADV_HUGEPAGE
+			madvise(start, huge, MADV_HUGEPAGE); // a hint; the kernel may still use 4 KB pages
+#endif
+			*backing = surfaceTHP;
+			*mapped = huge;
+			return start;
+		}
+	}
+	*mapped = 0;
+	if (*backing == surfaceMalloc) return malloc(bytes);
+	*backing = surfaceAligned;
+	return posix_memalign(&p, 64, bytes) ? NULL : p;
 }
 
-void drawStickmanAndCannon(Frame *frame, Coord shipPosition, RGB color, int counter){
-	
-	if(counter % 2 == 0){
-		//Draw cannon
-		drawCannon(frame, coord(shipPosition.x, shipPosition.y - 80 - 3), rgb(99,99,99));
-	}else{
-		//Draw cannon
-		drawCannon(frame, coord(shipPosition.x, shipPosition.y - 80), rgb(99,99,99));
+// give back a surface from allocSurface, the way its backing says it was taken
+void freeSurface(void* p, int backing, size_t mapped) {
+	if (backing >= surfaceTHP) munmap(p, mapped);
+	else free(p);
+}
+
+void printSurfaceStats(const char* indent) {
+	printf("%ssurfaces: %.1f MB peak, %.1f MB live;", indent, surfaceStats.peakBytes / 1048576.0, surfaceStats.liveBytes / 1048576.0);
+	for (int i = 0; i < surfaceBackings; i++) {
+		if (surfaceStats.allocations[i]) printf(" %lld %s", surfaceStats.allocations[i], surfaceBackingNames[i]);
 	}
-		
-	//Draw stickman
-	drawStickman(frame, coord(shipPosition.x - 30, shipPosition.y - 90), 15, rgb(99,99,99),counter);
+	printf("\n");
 }
 
+/* TRACING ------------------------------------------------------------- */
+
+/* Scope timers, compiled in with -DSHOOTER_TRACE and nothing at all
+ * otherwise. TRACE_SCOPE("name") times the rest of the enclosing block
+ * into the calling thread's ring, which keeps its last traceRingSize
+ * scopes. Only the owning thread writes a ring (it publishes with a
+ * release store of written), so recording takes no lock; rings are read
+ * once the threads are idle: as a Chrome trace_event file (--trace FILE,
+ * open it in chrome://tracing or Perfetto) and as per-stage histograms
+ * printed on exit.
+ */
+#ifdef SHOOTER_TRACE
 
-vector<Coord> getFishCoordinate(Coord center) {
-	vector<Coord> fishCoord;
+long long nowNs();
 
-	int xHeight = 72;
-	int yHeight = 12;
-	
+typedef struct s_traceEvent {
+	const char* name; // a string literal
+	long long startNs;
+	long long durNs;
+} TraceEvent;
 
-	fishCoord.push_back(coord(center.x, center.y));
-	fishCoord.push_back(coord(fishCoord.at(0).x + 7, fishCoord.at(0).y - 3));
-	fishCoord.push_back(coord(fishCoord.at(1).x + 10, fishCoord.at(1).y - 2));
-	fishCoord.push_back(coord(fishCoord.at(2).x + 15, fishCoord.at(2).y - 1));
-	fishCoord.push_back(coord(fishCoord.at(3).x + 15, fishCoord.at(3).y + 1));
-	fishCoord.push_back(coord(fishCoord.at(4).x + 12, fishCoord.at(4).y + 3));
-	fishCoord.push_back(coord(fishCoord.at(5).x + 7, fishCoord.at(5).y));
-	fishCoord.push_back(coord(fishCoord.at(6).x + 6, fishCoord.at(6).y - 6));
-	fishCoord.push_back(coord(fishCoord.at(7).x, fishCoord.at(7).y + 12));
-	fishCoord.push_back(coord(fishCoord.at(8).x - 6, fishCoord.at(8).y - 5)); 
-	fishCoord.push_back(coord(fishCoord.at(9).x - 7, fishCoord.at(9).y + 2));
-	fishCoord.push_back(coord(fishCoord.at(10).x - 12, fishCoord.at(10).y + 3));
-	fishCoord.push_back(coord(fishCoord.at(11).x - 15, fishCoord.at(11).y + 1));
-	fishCoord.push_back(coord(fishCoord.at(12).x - 15, fishCoord.at(12).y - 1));
-	fishCoord.push_back(coord(fishCoord.at(13).x - 10, fishCoord.at(13).y - 2));
+typedef struct s_traceRing {
+	TraceEvent event[traceRingSize];
+	atomic<long long> written; // scopes ever recorded; the last traceRingSize are kept
+	int thread;
+} TraceRing;
 
-	return fishCoord;
+mutex traceLock; // guards traceRings, taken once per thread
+vector<TraceRing*> traceRings; // never freed, so they can be read after their thread ends
+thread_local TraceRing* traceRing = NULL;
 
+TraceRing* registerTraceRing() {
+	lock_guard<mutex> guard(traceLock);
+	traceRing = new TraceRing;
+	traceRing->written = 0;
+	traceRing->thread = traceRings.size();
+	traceRings.push_back(traceRing);
+	return traceRing;
 }
 
-vector<Coord> getBirdCoordinate(Coord center) {
-	vector<Coord> birdCoord;
+struct TraceScope {
+	const char* name;
+	long long startNs;
+	TraceScope(const char* name) : name(name), startNs(nowNs()) {}
+	~TraceScope() {
+		TraceRing* ring = traceRing ? traceRing : registerTraceRing();
+		long long n = ring->written.load(memory_order_relaxed);
+		TraceEvent* e = &ring->event[n % traceRingSize];
+		e->name = name;
+		e->startNs = startNs;
+		e->durNs = nowNs() - startNs;
+		ring->written.store(n + 1, memory_order_release);
+	}
+};
 
-	birdCoord.push_back(coord(center.x, center.y));
-	birdCoord.push_back(coord(birdCoord.at(0).x+10, birdCoord.at(0).y-5));
-	birdCoord.push_back(coord(birdCoord.at(1).x+10, birdCoord.at(1).y+5));
-	birdCoord.push_back(coord(birdCoord.at(2).x+5, birdCoord.at(2).y+5));
-	birdCoord.push_back(coord(birdCoord.at(3).x+20, birdCoord.at(3).y+5));
-	birdCoord.push_back(coord(birdCoord.at(4).x+5, birdCoord.at(4).y));
-	birdCoord.push_back(coord(birdCoord.at(5).x-10, birdCoord.at(5).y+5));
-	birdCoord.push_back(coord(birdCoord.at(6).x-10, birdCoord.at(6).y));
-	birdCoord.push_back(coord(birdCoord.at(7).x-10, birdCoord.at(7).y-2));
-	birdCoord.push_back(coord(birdCoord.at(8).x-10, birdCoord.at(8).y-2));
-	birdCoord.push_back(coord(birdCoord.at(9).x-10, birdCoord.at(9).y-2));
-	birdCoord.push_back(coord(birdCoord.at(10).x-10, birdCoord.at(10).y-2));
+#define TRACE_JOIN(a, b) a##b
+#define TRACE_VARIABLE(line) TRACE_JOIN(traceScope, line)
+#define TRACE_SCOPE(name) TraceScope TRACE_VARIABLE(__LINE__)(name)
 
-	return birdCoord;
+// call f for every kept scope of every thread
+void forEachTraceEvent(void (*f)(const TraceRing* ring, const TraceEvent* e, void* arg), void* arg) {
+	lock_guard<mutex> guard(traceLock);
+	for (size_t r = 0; r < traceRings.size(); r++) {
+		long long written = traceRings[r]->written.load(memory_order_acquire);
+		for (long long n = max(0LL, written - traceRingSize); n < written; n++) {
+			f(traceRings[r], &traceRings[r]->event[n % traceRingSize], arg);
+		}
+	}
 }
 
-void drawFish(Frame  *frame, Coord center, RGB color) {
-	/*vector<Coord> fishCoord = getFishCoordinate(coord(center.x-30,center.y-20));
-	for(int i=0;i<fishCoord.size();++i) {
-		if(i!=fishCoord.size()-1)
-			plotLine(frame,fishCoord.at(i).x, fishCoord.at(i).y ,fishCoord.at(i+1).x, fishCoord.at(i+1).y, color);
-		else
-			plotLine(frame, fishCoord.at(i).x, fishCoord.at(i).y ,fishCoord.at(0).x, fishCoord.at(0).y, color);
-	}*/
-	
-	//panjang badan 12
-	//tinggi 10
-	//panjang moncong 10
-	//draw mulut
-	plotLine(frame, center.x -15, center.y -25, center.x -5, center.y -30, color);
-	plotLine(frame, center.x -15, center.y -25, center.x -5, center.y -20, color);
-	
-	//draw badan
-	plotLine(frame, center.x -5, center.y -30, center.x + 7, center.y -30, color);
-	plotLine(frame, center.x -5, center.y -20, center.x + 7, center.y -20, color);
-	
-	//draw pangkal ekor
-	plotLine(frame, center.x + 7, center.y -30, center.x + 7, center.y -26, color);
-	plotLine(frame, center.x + 7, center.y -20, center.x + 7, center.y -24, color);
-	
-	//draw ekor
-	plotLine(frame, center.x + 7, center.y -26, center.x + 14, center.y -30, color);
-	plotLine(frame, center.x + 7, center.y -24, center.x + 14, center.y -20, color);
-	plotLine(frame, center.x + 14, center.y -30, center.x + 14, center.y -20, color);
+typedef struct s_traceFile {
+	FILE* f;
+	long long originNs;
+	int first;
+} TraceFile;
+
+void findTraceOrigin(const TraceRing* ring, const TraceEvent* e, void* arg) {
+	TraceFile* t = (TraceFile*)arg;
+	if (t->first || e->startNs < t->originNs) t->originNs = e->startNs;
+	t->first = 0;
 }
 
-/* FUNCTIONS FOR SCANLINE ALGORITHM ---------------------------------------------------- */
+void writeTraceEvent(const TraceRing* ring, const TraceEvent* e, void* arg) {
+	TraceFile* t = (TraceFile*)arg;
+	fprintf(t->f, "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+		t->first ? "" : ",\n", e->name, ring->thread, (e->startNs - t->originNs) / 1000.0, e->durNs / 1000.0);
+	t->first = 0;
+}
 
-bool isSlopeEqualsZero(int y0, int y1){
-	if(y0 == y1){
-		return true;
-	}else{
-		return false;
-	}
+// the kept scopes as Chrome trace_event JSON, timestamps in us from the first one
+int writeTrace(const char* path) {
+	TraceFile t;
+	t.f = fopen(path, "w");
+	if (!t.f) return -1;
+	t.first = 1;
+	t.originNs = 0;
+	forEachTraceEvent(findTraceOrigin, &t);
+	t.first = 1;
+	fprintf(t.f, "{\"traceEvents\": [\n");
+	forEachTraceEvent(writeTraceEvent, &t);
+	fprintf(t.f, "\n]}\n");
+	fclose(t.f);
+	return 0;
 }
 
-bool isInBetween(int y0, int y1, int yTest){
-	if((yTest >= y0 && yTest <= y1 || yTest >= y1 && yTest <= y0) && !isSlopeEqualsZero(y0, y1)){
-		return true;
-	}else{
-		return false;
+// durations of one stage (scope name) over all threads
+typedef struct s_traceStage {
+	const char* name;
+	vector<long long> durNs;
+} TraceStage;
+
+void addTraceStage(const TraceRing* ring, const TraceEvent* e, void* arg) {
+	vector<TraceStage>* stages = (vector<TraceStage>*)arg;
+	size_t i;
+	for (i = 0; i < stages->size() && strcmp((*stages)[i].name, e->name); i++);
+	if (i == stages->size()) {
+		stages->push_back(TraceStage());
+		stages->back().name = e->name;
 	}
+	(*stages)[i].durNs.push_back(e->durNs);
 }
 
-/* Function to calculate intersection between line (a,b) and line with slope 0 */
-Coord intersection(Coord a, Coord b, int y){
-	int x;
-	double slope;
-	
-	if(b.x == a.x){
-		x = a.x;
-	}else{
-		slope = (double)(b.y - a.y) / (double)(b.x - a.x);
-		x = round(((double)(y - a.y) / slope) + (double)a.x);
+// per stage: percentiles and a histogram in powers of 4 us
+void printTraceStats() {
+	vector<TraceStage> stages;
+	forEachTraceEvent(addTraceStage, &stages);
+	if (stages.empty()) return;
+	printf("trace, last %d scopes per thread:\n", traceRingSize);
+	printf("  %-16s %7s %9s %9s %9s %9s   %s\n", "stage", "count", "p50 us", "p90 us", "p99 us", "max us", "<1us <4 <16 <64 <256 <1ms <4ms more");
+	for (size_t i = 0; i < stages.size(); i++) {
+		vector<long long>& d = stages[i].durNs;
+		sort(d.begin(), d.end());
+		int bucket[8] = {0};
+		for (size_t k = 0; k < d.size(); k++) {
+			int b = 0;
+			for (long long limit = 1000; b < 7 && d[k] >= limit; limit *= 4) b++;
+			bucket[b]++;
+		}
+		printf("  %-16s %7zu %9.1f %9.1f %9.1f %9.1f  ", stages[i].name, d.size(), d[d.size() / 2] / 1000.0,
+			d[d.size() * 9 / 10] / 1000.0, d[(d.size() - 1) * 99 / 100] / 1000.0, d.back() / 1000.0);
+		for (int b = 0; b < 8; b++) printf(" %d", bucket[b]);
+		printf("\n");
 	}
-	
-	return coord(x, y);
 }
 
-bool compareByAxis(const s_coord &a, const s_coord &b){
-	return a.x <= b.x;
+// on exit: the histograms, and the trace file if one was asked for
+void finishTrace(const char* path) {
+	printTraceStats();
+	if (path && writeTrace(path)) printf("Error: cannot write trace %s.\n", path);
 }
 
-bool compareSameAxis(const s_coord &a, const s_coord &b){
-	return a.x == b.x;
-}
+#else
+#define TRACE_SCOPE(name)
+#endif
 
-vector<Coord> intersectionGenerator(int y, vector<Coord> polygon){
-	vector<Coord> intersectionPoint;
+/* VIDEO OPERATIONS ---------------------------------------------------- */
+
+// construct RGB
+RGB rgb(unsigned char r, unsigned char g, unsigned char b) {
+	RGB retval;
+	retval.r = r;
+	retval.g = g;
+	retval.b = b;
+	return retval;
+}
+
+// pack RGB into a frame pixel (BGRX, X fully opaque)
+uint32_t packRGB(RGB col) {
+	return 0xFF000000u | ((uint32_t)col.r << 16) | ((uint32_t)col.g << 8) | col.b;
+}
+
+// unpack a frame pixel back into RGB
+RGB unpackRGB(uint32_t px) {
+	return rgb((px >> 16) & 0xFF, (px >> 8) & 0xFF, px & 0xFF);
+}
+
+// a frame without pixels yet; stride 0 picks surfaceStride
+Frame frameLayout(int width, int height, int stride, int pixelBytes, int backing) {
+	Frame retval;
+	retval.px = NULL;
+	retval.index = NULL;
+	retval.width = width;
+	retval.height = height;
+	retval.stride = stride >= width ? stride : surfaceStride(width, pixelBytes);
+	retval.clip = rect(0, 0, width, height);
+	retval.damage = NULL;
+	retval.backing = backing;
+	retval.bytes = (size_t)retval.stride * height * pixelBytes;
+	return retval;
+}
+
+// allocate frm->bytes with at most frm->backing
+void* allocFramePixels(Frame* frm) {
+	void* p = allocSurface(frm->bytes, &frm->backing, &frm->mapped);
+	if (!p) {
+		printf("Error: cannot allocate %dx%d frame.\n", frm->width, frm->height);
+		exit(5);
+	}
+	surfaceStats.allocations[frm->backing]++;
+	surfaceStats.liveBytes += frm->bytes;
+	surfaceStats.peakBytes = max(surfaceStats.peakBytes, surfaceStats.liveBytes);
+	return p;
+}
+
+// allocate a frame with at most the given backing; stride 0 picks surfaceStride
+Frame newFrame(int width, int height, int stride = 0, int backing = surfaceBacking) {
+	Frame retval = frameLayout(width, height, stride, sizeof(uint32_t), backing);
+	retval.px = (uint32_t*)allocFramePixels(&retval);
+	return retval;
+}
+
+// a byte per pixel, drawn with palette indices (framePixel); a quarter of the traffic of newFrame
+Frame newIndexedFrame(int width, int height, int backing = surfaceBacking) {
+	Frame retval = frameLayout(width, height, 0, 1, backing);
+	retval.index = (unsigned char*)allocFramePixels(&retval);
+	return retval;
+}
+
+void freeFrame(Frame* frm) {
+	freeSurface(frm->px ? (void*)frm->px : (void*)frm->index, frm->backing, frm->mapped);
+	surfaceStats.liveBytes -= frm->bytes;
+	frm->px = NULL;
+	frm->index = NULL;
+}
+
+// start of row y
+uint32_t* frameRow(Frame* frm, int y) {
+	return frm->px + (size_t)y * frm->stride;
+}
+
+// start of row y of an indexed frame
+unsigned char* indexRow(Frame* frm, int y) {
+	return frm->index + (size_t)y * frm->stride;
+}
+
+// a view of frm that shares its pixels but only draws inside clip, with its own damage
+Frame frameView(Frame* frm, Rect clip, Damage* damage) {
+	Frame retval = *frm;
+	retval.clip = rectIntersect(frm->clip, clip);
+	retval.damage = damage;
+	return retval;
+}
+
+/* PALETTE ------------------------------------------------------------- */
+
+/* The colors of indexed frames, shared by all of them. It only grows and an
+ * index never changes color, so threads can look colors up, and present
+ * can expand indices, while another thread adds one: lookups scan the
+ * first count entries without a lock, adding takes the lock and publishes
+ * the entry through count. The game uses a few dozen colors; past 256 a
+ * color gets the nearest entry.
+ */
+typedef struct s_palette {
+	uint32_t color[256]; // packed BGRX
+	atomic<int> count;
+	mutex lock;
+} Palette;
+
+Palette palette;
+
+int findPaletteColor(uint32_t px, int count) {
+	for (int i = 0; i < count; i++) {
+		if (palette.color[i] == px) return i;
+	}
+	return -1;
+}
+
+int nearestPaletteColor(uint32_t px) {
+	int best = 0;
+	int bestDistance = -1;
+	for (int i = 0; i < 256; i++) {
+		int distance = 0;
+		for (int shift = 0; shift < 24; shift += 8) {
+			int d = (int)((px >> shift) & 0xFF) - (int)((palette.color[i] >> shift) & 0xFF);
+			distance += d * d;
+		}
+		if (bestDistance < 0 || distance < bestDistance) {
+			best = i;
+			bestDistance = distance;
+		}
+	}
+	return best;
+}
+
+// the index of a packed pixel, added to the palette if it is new
+unsigned char paletteIndex(uint32_t px) {
+	int i = findPaletteColor(px, palette.count.load(memory_order_acquire));
+	if (i >= 0) return i;
+	lock_guard<mutex> guard(palette.lock);
+	int count = palette.count.load(memory_order_relaxed);
+	i = findPaletteColor(px, count); // added while we waited
+	if (i >= 0) return i;
+	if (count == 256) return nearestPaletteColor(px);
+	palette.color[count] = px;
+	palette.count.store(count + 1, memory_order_release);
+	return count;
+}
+
+// what the primitives store for col on frm: packed BGRX, or its palette index
+uint32_t framePixel(Frame* frm, RGB col) {
+	return frm->index ? paletteIndex(packRGB(col)) : packRGB(col);
+}
+
+/* DAMAGE TRACKING ----------------------------------------------------- */
+
+void initDamage(Damage* dmg) {
+	memset(dmg, 0, sizeof(Damage));
+}
+
+// add r to a rect list, merging it into the cheapest neighbour once the list is full
+void addDirtyRect(Rect* list, int* count, Rect r) {
+	int i;
+	for (i = 0; i < *count; i++) {
+		if (rectArea(rectIntersect(list[i], r)) == rectArea(r)) return; // already covered
+	}
+	if (*count < maxDirtyRects) {
+		list[(*count)++] = r;
+		return;
+	}
+	int best = 0;
+	long long bestGrowth = -1;
+	for (i = 0; i < *count; i++) {
+		long long growth = rectArea(rectUnion(list[i], r)) - rectArea(list[i]);
+		if (bestGrowth < 0 || growth < bestGrowth) {
+			best = i;
+			bestGrowth = growth;
+		}
+	}
+	list[best] = rectUnion(list[best], r);
+}
+
+// merge overlapping rects so nothing gets cleared or copied twice
+int coalesceRects(Rect* list, int count) {
+	int merged = 1;
+	while (merged) {
+		merged = 0;
+		for (int i = 0; i < count && !merged; i++) {
+			for (int j = i + 1; j < count && !merged; j++) {
+				if (!isRectEmpty(rectIntersect(list[i], list[j]))) {
+					list[i] = rectUnion(list[i], list[j]);
+					list[j] = list[--count];
+					merged = 1;
+				}
+			}
+		}
+	}
+	return count;
+}
+
+// record the inclusive box (xmin,ymin)-(xmax,ymax) as drawn on frm
+void markDirty(Frame* frm, int xmin, int ymin, int xmax, int ymax) {
+	if (!frm->damage) return;
+	Rect r = rectIntersect(rect(xmin, ymin, xmax + 1, ymax + 1), frm->clip);
+	if (isRectEmpty(r)) return;
+	addDirtyRect(frm->damage->cur, &frm->damage->curCount, r);
+}
+
+// everything that changed since the previous frame: last frame's rects plus this frame's
+int damagedRegion(Damage* dmg, Rect* out) {
+	int count = 0;
+	int i;
+	for (i = 0; i < dmg->prevCount; i++) out[count++] = dmg->prev[i];
+	for (i = 0; i < dmg->curCount; i++) out[count++] = dmg->cur[i];
+	return coalesceRects(out, count);
+}
+
+// start a new frame: this frame's rects become the previous ones
+void nextDamageFrame(Damage* dmg) {
+	memcpy(dmg->prev, dmg->cur, sizeof(dmg->cur));
+	dmg->prevCount = dmg->curCount;
+	dmg->curCount = 0;
+	dmg->frames++;
+}
+
+void printDamageStats(const char* name, Frame* frm) {
+	if (!frm->damage || !frm->damage->frames) return;
+	long long perFrame = frm->damage->pixelsTouched / frm->damage->frames;
+	printf("%s: %lld of %d pixels touched per frame (%.1f%%)\n", name, perFrame,
+		frm->width * frm->height, 100.0 * perFrame / (frm->width * frm->height));
+}
+
+// store a frame pixel (framePixel) at (x,y), unclipped
+inline void storePixel(Frame* frm, int x, int y, uint32_t px) {
+	if (frm->index) indexRow(frm, y)[x] = px;
+	else frameRow(frm, y)[x] = px;
+}
+
+// insert packed pixel to composition frame, with bounds filter
+void insertPackedPixel(Frame* frm, int x, int y, uint32_t px) {
+	if (!(x >= frm->clip.x1 || x < frm->clip.x0 || y >= frm->clip.y1 || y < frm->clip.y0)) {
+		storePixel(frm, x, y, px);
+	}
+}
+
+// insert pixel to composition frame, with bounds filter
+void insertPixel(Frame* frm, Coord loc, RGB col) {
+	insertPackedPixel(frm, loc.x, loc.y, framePixel(frm, col));
+}
+
+// fill count pixels; spans too short to amortize a kernel call are written inline
+inline void fillSpan(uint32_t* dst, uint32_t px, int count) {
+	if (count >= 16) {
+		kernels.fillRow(dst, px, count);
+		return;
+	}
+	for (int i = 0; i < count; i++) dst[i] = px;
+}
+
+// fill count frame pixels of row y from x, unclipped
+inline void fillFrameSpan(Frame* frm, int x, int y, uint32_t px, int count) {
+	if (frm->index) memset(indexRow(frm, y) + x, px, count);
+	else fillSpan(frameRow(frm, y) + x, px, count);
+}
+
+// fill a rect of frm with a frame pixel
+void fillRect(Frame* frm, Rect r, uint32_t px) {
+	for (int y = r.y0; y < r.y1; y++) {
+		fillFrameSpan(frm, r.x0, y, px, r.x1 - r.x0);
+	}
+}
+
+// delete contents of composition frame
+void flushFrame (Frame* frm, RGB color) {
+	TRACE_SCOPE("flushFrame");
+	fillRect(frm, frm->clip, framePixel(frm, color));
+	markDirty(frm, frm->clip.x0, frm->clip.y0, frm->clip.x1 - 1, frm->clip.y1 - 1);
+}
+
+/* Delete only what was drawn since the last flush, then start a new frame.
+ * Expects frm to have been flushed whole once; without damage it flushes whole.
+ */
+void flushDirty (Frame* frm, RGB color) {
+	TRACE_SCOPE("flushDirty");
+	if (!frm->damage) {
+		flushFrame(frm, color);
+		return;
+	}
+	Damage* dmg = frm->damage;
+	dmg->curCount = coalesceRects(dmg->cur, dmg->curCount);
+	uint32_t px = framePixel(frm, color);
+	for (int i = 0; i < dmg->curCount; i++) {
+		fillRect(frm, dmg->cur[i], px);
+		dmg->pixelsTouched += rectArea(dmg->cur[i]);
+	}
+	nextDamageFrame(dmg);
+}
+
+/* Framebuffer pixel formats. Drawing always happens on BGRX frames; a
+ * format only says how a row of those is stored in the framebuffer, so the
+ * present path is instantiated once per format and picked when the backend
+ * opens. Layouts are the usual little-endian fbdev ones; the channel
+ * offsets and lengths are as fbdev reports them, to match a mode against.
+ */
+struct FormatXRGB8888 {
+	enum { bits = 32, bytes = 4 };
+	enum { redOffset = 16, redLength = 8, greenOffset = 8, greenLength = 8, blueOffset = 0, blueLength = 8 };
+	static void convertRow(char* dst, const uint32_t* src, int count) {
+		kernels.convertRow((uint32_t*)dst, src, count);
+	}
+};
+
+struct FormatRGB888 {
+	enum { bits = 24, bytes = 3 };
+	enum { redOffset = 16, redLength = 8, greenOffset = 8, greenLength = 8, blueOffset = 0, blueLength = 8 };
+	static void convertRow(char* dst, const uint32_t* src, int count) {
+		unsigned char* d = (unsigned char*)dst;
+		for (int i = 0; i < count; i++, d += 3) {
+			d[0] = src[i];       // B
+			d[1] = src[i] >> 8;  // G
+			d[2] = src[i] >> 16; // R
+		}
+	}
+};
+
+struct FormatRGB565 {
+	enum { bits = 16, bytes = 2 };
+	enum { redOffset = 11, redLength = 5, greenOffset = 5, greenLength = 6, blueOffset = 0, blueLength = 5 };
+	static void convertRow(char* dst, const uint32_t* src, int count) {
+		uint16_t* d = (uint16_t*)dst;
+		for (int i = 0; i < count; i++) {
+			uint32_t px = src[i];
+			d[i] = ((px >> 8) & 0xF800) | ((px >> 5) & 0x07E0) | ((px >> 3) & 0x001F);
+		}
+	}
+};
+
+/* Copy composition Frame to FrameBuffer, one row at a time. If frm tracks
+ * damage only what changed is copied: since the last present, or with two
+ * pages since the one before it, because that went to the other page.
+ */
+template <class PF>
+void showFrame (Frame* frm, FrameBuffer* fb, int pages = 1) {
+	TRACE_SCOPE("showFrame");
+	Rect screen = rectIntersect(frm->clip, rect(0, 0, fb->lineLen / PF::bytes, fb->smemLen / fb->lineLen));
+	Rect region[2 * maxDirtyRects];
+	int count = 1;
+	region[0] = screen;
+	if (frm->damage && pages == 1) {
+		memcpy(region, frm->damage->cur, sizeof(frm->damage->cur));
+		count = coalesceRects(region, frm->damage->curCount);
+	} else if (frm->damage && pages == 2) {
+		count = damagedRegion(frm->damage, region);
+	}
+	for (int i = 0; i < count; i++) {
+		Rect r = rectIntersect(region[i], screen);
+		if (isRectEmpty(r)) continue;
+		for (int y = r.y0; y < r.y1; y++) {
+			PF::convertRow(fb->ptr + (size_t)y * fb->lineLen + r.x0 * PF::bytes, frameRow(frm, y) + r.x0, r.x1 - r.x0);
+		}
+		if (frm->damage) frm->damage->pixelsTouched += rectArea(r);
+	}
+	if (frm->damage) nextDamageFrame(frm->damage);
+}
+
+/* Composite the canvas onto frm. If the canvas tracks damage only the area
+ * that changed since the last composite is copied (and marked on frm);
+ * everything else on frm is expected to still hold the previous composite.
+ */
+void showCanvas(Frame* frm, Frame* cnvs, int canvasWidth, int canvasHeight, Coord loc, RGB borderColor, int isBorder) {
+	TRACE_SCOPE("showCanvas");
+	int y;
+	int originX = loc.x - canvasWidth/2;
+	int originY = loc.y - canvasHeight/2;
+	Rect region[2 * maxDirtyRects];
+	int count = 1;
+	region[0] = cnvs->clip;
+	if (cnvs->damage) {
+		count = damagedRegion(cnvs->damage, region);
+	}
+	// the canvas area on frm, in canvas coordinates
+	Rect visible = rect(frm->clip.x0 - originX, frm->clip.y0 - originY, frm->clip.x1 - originX, frm->clip.y1 - originY);
+	visible = rectIntersect(visible, rectIntersect(cnvs->clip, rect(0, 0, canvasWidth, canvasHeight)));
+	for (int i = 0; i < count; i++) {
+		Rect r = rectIntersect(region[i], visible);
+		if (isRectEmpty(r)) continue;
+		// row-block copy through the cache: frm is read again right away by present;
+		// an indexed canvas is expanded to pixels here, its only trip through the palette
+		for (y=r.y0; y<r.y1;y++) {
+			uint32_t* dst = frameRow(frm, originY + y) + originX + r.x0;
+			if (cnvs->index) kernels.expandRow(dst, indexRow(cnvs, y) + r.x0, r.x1 - r.x0, palette.color);
+			else memcpy(dst, frameRow(cnvs, y) + r.x0, (r.x1 - r.x0) * sizeof(uint32_t));
+		}
+		markDirty(frm, originX + r.x0, originY + r.y0, originX + r.x1 - 1, originY + r.y1 - 1);
+		if (cnvs->damage) cnvs->damage->pixelsTouched += rectArea(r);
+	}
 	
-	for(int i = 0; i < polygon.size(); i++){
-		if(i == polygon.size() - 1){
-			if(isInBetween(polygon.at(i).y, polygon.at(0).y, y)){				
-				Coord a = coord(polygon.at(i).x, polygon.at(i).y);
-				Coord b = coord(polygon.at(0).x, polygon.at(0).y);
-				
-				intersectionPoint.push_back(intersection(a, b, y));
+	//show border
+	if(isBorder){
+		// left, right, top and bottom edge as clipped spans (corners stay open)
+		Rect edge[4] = {
+			rect(originX - 1, originY, originX, originY + canvasHeight),
+			rect(originX + canvasWidth, originY, originX + canvasWidth + 1, originY + canvasHeight),
+			rect(originX, originY - 1, originX + canvasWidth, originY),
+			rect(originX, originY + canvasHeight, originX + canvasWidth, originY + canvasHeight + 1),
+		};
+		uint32_t px = packRGB(borderColor);
+		for (int i = 0; i < 4; i++) {
+			Rect r = rectIntersect(edge[i], frm->clip);
+			if (!isRectEmpty(r)) fillRect(frm, r, px);
+		}
+	}
+}
+
+void addBlob(Frame* cnvs, Coord loc, RGB color) {
+	int x,y;
+	markDirty(cnvs, loc.x-2, loc.y-2, loc.x+2, loc.y+2);
+	for (y=-2; y<3;y++) {
+		for (x=-2; x<3; x++) {
+			if (!(abs(x)==2 && abs(y)==2)) {
+				insertPixel(cnvs, coord(loc.x+x, loc.y+y), color);
 			}
-		}else{
-			if(isInBetween(polygon.at(i).y, polygon.at(i + 1).y, y)){
-				Coord a = coord(polygon.at(i).x, polygon.at(i).y);
-				Coord b = coord(polygon.at(i + 1).x, polygon.at(i + 1).y);
-				
-				intersectionPoint.push_back(intersection(a, b, y));
+		}
+	}
+}
+
+	
+/* Clipping for the line and circle primitives: each primitive (or each
+ * quadrant of a circle) is tested against frm->clip once. Lines that
+ * straddle the clip edge are cut to the pixels inside; circle quadrants
+ * that do fall back to insertPackedPixel.
+ */
+enum { clipOutside, clipInside, clipPartial };
+
+// Cohen-Sutherland outcode of (x,y) against the clip rect
+int outcode(const Rect* r, int x, int y) {
+	return (x < r->x0) | (x >= r->x1) << 1 | (y < r->y0) << 2 | (y >= r->y1) << 3;
+}
+
+// how to draw inside the inclusive box (xmin,ymin)-(xmax,ymax)
+int clipBox(Frame* frm, int xmin, int ymin, int xmax, int ymax) {
+	if (outcode(&frm->clip, xmin, ymin) & outcode(&frm->clip, xmax, ymax)) return clipOutside;
+	if (!(outcode(&frm->clip, xmin, ymin) | outcode(&frm->clip, xmax, ymax))) return clipInside;
+	return clipPartial;
+}
+
+// write a pixel as decided by clipBox
+inline void plotClipped(Frame* frm, int mode, int x, int y, uint32_t px) {
+	if (mode == clipInside) storePixel(frm, x, y, px);
+	else if (mode == clipPartial) insertPackedPixel(frm, x, y, px);
+}
+
+// blend packed px over a pixel at coverage alpha, as decided by clipBox (BGRX frames)
+inline void plotBlended(Frame* frm, int mode, int x, int y, uint32_t px, int alpha) {
+	if (alpha == 0 || mode == clipOutside) return;
+	if (mode == clipPartial && (x < frm->clip.x0 || x >= frm->clip.x1 || y < frm->clip.y0 || y >= frm->clip.y1)) return;
+	uint32_t* p = frameRow(frm, y) + x;
+	*p = alpha == 255 ? px : blendPixel(*p, scalePixel(px, alpha));
+}
+
+// inclusive span on row y, clipped once
+void plotHLine(Frame* frm, int x0, int x1, int y, uint32_t px) {
+	if (y < frm->clip.y0 || y >= frm->clip.y1) return;
+	int xl = max(min(x0, x1), frm->clip.x0);
+	int xr = min(max(x0, x1), frm->clip.x1 - 1);
+	if (xl <= xr) fillFrameSpan(frm, xl, y, px, xr - xl + 1);
+}
+
+// count pixels down from p, for either pixel width
+template <typename P>
+void fillColumn(P* p, int stride, int count, P px) {
+	for (int i = 0; i < count; i++, p += stride) *p = px;
+}
+
+// inclusive column at x, clipped once
+void plotVLine(Frame* frm, int x, int y0, int y1, uint32_t px) {
+	if (x < frm->clip.x0 || x >= frm->clip.x1) return;
+	int yt = max(min(y0, y1), frm->clip.y0);
+	int yb = min(max(y0, y1), frm->clip.y1 - 1);
+	if (frm->index) fillColumn<unsigned char>(indexRow(frm, yt) + x, frm->stride, yb - yt + 1, px);
+	else fillColumn<uint32_t>(frameRow(frm, yt) + x, frm->stride, yb - yt + 1, px);
+}
+
+/* Bresenham from p for steps more pixels on the major axis, with nothing
+ * clipped: err is the error term at p, dx and dy (negative) those of the
+ * whole line. The pointer steps along, for either pixel width.
+ */
+template <typename P>
+void traceLine(P* p, int stride, int dx, int dy, int sx, int sy, int err, int steps, P px) {
+	int e2;
+	int stepY = sy * stride;
+	while (1) {
+		*p = px;
+		if (steps-- == 0) break;
+		e2 = 2*err;
+		if (e2 >= dy) { err += dy; p += sx; }    /* e_xy+e_x > 0 */
+		if (e2 <= dx) { err += dx; p += stepY; } /* e_xy+e_y < 0 */
+	}
+}
+
+/* Bresenham takes a minor axis step with every major one whose error
+ * crosses half a pixel, so after k major steps of a line a pixels long on
+ * its major axis and b on its minor one it has taken this many.
+ */
+inline long long minorSteps(long long a, long long b, long long k) {
+	return (2*b*k + a) / (2*a);
+}
+
+// the steps [*lo, *hi] from start in direction s (+-1) that land in [clipLo, clipHi]
+void axisSteps(int start, int s, int clipLo, int clipHi, long long* lo, long long* hi) {
+	*lo = s > 0 ? clipLo - start : start - clipHi;
+	*hi = s > 0 ? clipHi - start : start - clipLo;
+}
+
+void plotCircle(Frame* frm,int xm, int ym, int r,RGB col)
+{
+   markDirty(frm, xm-r, ym-r, xm+r, ym+r);
+   uint32_t px = framePixel(frm, col);
+   int x = -r, y = 0, err = 2-2*r; /* II. Quadrant */ 
+   if (clipBox(frm, xm-r, ym-r, xm+r, ym+r) == clipInside) {
+      do {
+         storePixel(frm, xm-x, ym+y, px); /*   I. Quadrant */
+         storePixel(frm, xm-y, ym-x, px); /*  II. Quadrant */
+         storePixel(frm, xm+x, ym-y, px); /* III. Quadrant */
+         storePixel(frm, xm+y, ym+x, px); /*  IV. Quadrant */
+         r = err;
+         if (r <= y) err += ++y*2+1;           /* e_xy+e_y < 0 */
+         if (r > x || err > y) err += ++x*2+1; /* e_xy+e_x > 0 or no 2nd y-step */
+      } while (x < 0);
+      return;
+   }
+   int q1 = clipBox(frm, xm, ym, xm+r, ym+r);
+   int q2 = clipBox(frm, xm-r, ym, xm, ym+r);
+   int q3 = clipBox(frm, xm-r, ym-r, xm, ym);
+   int q4 = clipBox(frm, xm, ym-r, xm+r, ym);
+   do {
+      plotClipped(frm, q1, xm-x, ym+y, px); /*   I. Quadrant */
+      plotClipped(frm, q2, xm-y, ym-x, px); /*  II. Quadrant */
+      plotClipped(frm, q3, xm+x, ym-y, px); /* III. Quadrant */
+      plotClipped(frm, q4, xm+y, ym+x, px); /*  IV. Quadrant */
+      r = err;
+      if (r <= y) err += ++y*2+1;           /* e_xy+e_y < 0 */
+      if (r > x || err > y) err += ++x*2+1; /* e_xy+e_x > 0 or no 2nd y-step */
+   } while (x < 0);
+}
+
+void plotHalfCircle(Frame *frm,int xm, int ym, int r,RGB col)
+{
+   markDirty(frm, xm-r, ym-r, xm+r, ym);
+   uint32_t px = framePixel(frm, col);
+   int q3 = clipBox(frm, xm-r, ym-r, xm, ym);
+   int q4 = clipBox(frm, xm, ym-r, xm+r, ym);
+   if (q3 == clipOutside && q4 == clipOutside) return;
+   int x = -r, y = 0, err = 2-2*r; /* II. Quadrant */ 
+   do {
+      plotClipped(frm, q3, xm+x, ym-y, px); /* III. Quadrant */
+      plotClipped(frm, q4, xm+y, ym+x, px); /*  IV. Quadrant */
+      r = err;
+      if (r <= y) err += ++y*2+1;           /* e_xy+e_y < 0 */
+      if (r > x || err > y) err += ++x*2+1; /* e_xy+e_x > 0 or no 2nd y-step */
+   } while (x < 0);
+}
+
+/* Fungsi membuat garis */
+void plotLine(Frame* frm, int x0, int y0, int x1, int y1, RGB lineColor)
+{
+	uint32_t px = framePixel(frm, lineColor);
+	markDirty(frm, min(x0,x1), min(y0,y1), max(x0,x1), max(y0,y1));
+	int c0 = outcode(&frm->clip, x0, y0);
+	int c1 = outcode(&frm->clip, x1, y1);
+	if (c0 & c1) return; // trivially rejected
+	if (y0 == y1) { plotHLine(frm, x0, x1, y0, px); return; }
+	if (x0 == x1) { plotVLine(frm, x0, y0, y1, px); return; }
+
+	int dx =  abs(x1-x0), sx = x0<x1 ? 1 : -1;
+	int dy = -abs(y1-y0), sy = y0<y1 ? 1 : -1;
+	int xMajor = dx >= -dy;
+	long long a = xMajor ? dx : -dy; // major axis length; every step moves on it
+	long long b = xMajor ? -dy : dx;
+	long long first = 0, last = a;   // major steps drawn
+
+	if (c0 | c1) {
+		// Liang-Barsky in whole steps: the major axis bounds them directly,
+		// the minor axis through minorSteps, solved for k
+		long long pLo, pHi, qLo, qHi;
+		if (xMajor) {
+			axisSteps(x0, sx, frm->clip.x0, frm->clip.x1 - 1, &pLo, &pHi);
+			axisSteps(y0, sy, frm->clip.y0, frm->clip.y1 - 1, &qLo, &qHi);
+		} else {
+			axisSteps(y0, sy, frm->clip.y0, frm->clip.y1 - 1, &pLo, &pHi);
+			axisSteps(x0, sx, frm->clip.x0, frm->clip.x1 - 1, &qLo, &qHi);
+		}
+		first = max(first, pLo);
+		last = min(last, pHi);
+		if (qLo > 0) first = max(first, (2*a*qLo - a + 2*b - 1) / (2*b));
+		if (qHi < 0) return;
+		if (qHi < b) last = min(last, (2*a*qHi + a - 1) / (2*b));
+		if (first > last) return;
+	}
+
+	// the Bresenham state after first steps, where the clipped line enters
+	long long m = minorSteps(a, b, first);
+	long long xSteps = xMajor ? first : m;
+	long long ySteps = xMajor ? m : first;
+	int x = x0 + sx * xSteps;
+	int y = y0 + sy * ySteps;
+	int err = dx + dy + xSteps*dy + ySteps*dx; /* error value e_xy */
+	if (frm->index) traceLine<unsigned char>(indexRow(frm, y) + x, frm->stride, dx, dy, sx, sy, err, last - first, px);
+	else traceLine<uint32_t>(frameRow(frm, y) + x, frm->stride, dx, dy, sx, sy, err, last - first, px);
+}
+
+/* Fill the area between two concentric plotHalfCircle arcs (exclusive),
+ * e.g. the wings of drawBird. Uses the same stepping as plotHalfCircle so
+ * the fill meets its pixels exactly.
+ */
+void fillHalfRing(Frame *frm, int xm, int ym, int rOuter, int rInner, RGB col)
+{
+	static thread_local vector<int> outerL, outerR, innerL, innerR;
+	outerL.assign(rOuter + 1, rOuter + 1); // nearest outer pixel to the center, per row
+	outerR.assign(rOuter + 1, rOuter + 1);
+	innerL.assign(rOuter + 1, -1);         // farthest inner pixel from the center, per row
+	innerR.assign(rOuter + 1, -1);
+
+	for (int pass = 0; pass < 2; pass++) {
+		int r = pass == 0 ? rOuter : rInner;
+		int x = -r, y = 0, err = 2-2*r;
+		do {
+			if (pass == 0) {
+				outerL[y] = min(outerL[y], -x);  /* III. Quadrant */
+				outerR[-x] = min(outerR[-x], y); /*  IV. Quadrant */
+			} else {
+				innerL[y] = max(innerL[y], -x);
+				innerR[-x] = max(innerR[-x], y);
+			}
+			r = err;
+			if (r <= y) err += ++y*2+1;
+			if (r > x || err > y) err += ++x*2+1;
+		} while (x < 0);
+	}
+
+	for (int t = 1; t <= rOuter; t++) {
+		if (innerL[t] < 0 && innerR[t] < 0) {
+			if (outerL[t] + outerR[t] > 1) plotLine(frm, xm - outerL[t] + 1, ym - t, xm + outerR[t] - 1, ym - t, col);
+		} else {
+			if (innerL[t] + 1 < outerL[t]) plotLine(frm, xm - outerL[t] + 1, ym - t, xm - innerL[t] - 1, ym - t, col);
+			if (innerR[t] + 1 < outerR[t]) plotLine(frm, xm + innerR[t] + 1, ym - t, xm + outerR[t] - 1, ym - t, col);
+		}
+	}
+}
+
+// coverage of a pixel dist from the middle of a line halfWidth + 1/2 wide, fading over its last pixel
+inline int lineAlpha(float dist, float halfWidth) {
+	float outside = dist - halfWidth + 1;
+	return outside <= 0 ? 255 : outside >= 1 ? 0 : (int)(255 * (1 - outside) + 0.5f);
+}
+
+/* Anti-aliased line wd pixels wide (Zingl's algorithm): every pixel near
+ * the line is blended in by its distance from it. BGRX frames only.
+ */
+void plotLineWidth(Frame* frm, int x0, int y0, int x1, int y1, float wd, RGB lineColor) { 
+	int dx = abs(x1-x0), sx = x0 < x1 ? 1 : -1; 
+	int dy = abs(y1-y0), sy = y0 < y1 ? 1 : -1; 
+	int err = dx-dy, e2, x2, y2;                          /* error value e_xy */
+	uint32_t px = packRGB(lineColor);
+
+	float ed = dx+dy == 0 ? 1 : sqrt((float)dx*dx+(float)dy*dy);
+	int pad = (int)ceil(wd);
+	markDirty(frm, min(x0,x1)-pad, min(y0,y1)-pad, max(x0,x1)+pad, max(y0,y1)+pad);
+	int mode = clipBox(frm, min(x0,x1)-pad, min(y0,y1)-pad, max(x0,x1)+pad, max(y0,y1)+pad);
+	if (mode == clipOutside) return;
+
+	for (wd = (wd+1)/2; ; ) {                                   /* pixel loop */
+		plotBlended(frm, mode, x0, y0, px, lineAlpha(abs(err-dx+dy)/ed, wd));
+
+		e2 = err; x2 = x0;
+		if (2*e2 >= -dx) {                                           /* x step */
+			for (e2 += dy, y2 = y0; e2 < ed*wd && (y1 != y2 || dx > dy); e2 += dx) {
+				y2 += sy;
+				plotBlended(frm, mode, x0, y2, px, lineAlpha(abs(e2)/ed, wd));
+			}
+			if (x0 == x1) break;
+			e2 = err; err -= dy; x0 += sx; 
+		} 
+		
+		if (2*e2 <= dy) {                                            /* y step */
+			for (e2 = dx-e2; e2 < ed*wd && (x1 != x2 || dx < dy); e2 += dy) {
+				x2 += sx;
+				plotBlended(frm, mode, x2, y0, px, lineAlpha(abs(e2)/ed, wd));
 			}
+			if (y0 == y1) break;
+			err += dx; y0 += sy; 
 		}
 	}
-	
-	sort(intersectionPoint.begin(), intersectionPoint.end(), compareByAxis);
-	
-	return intersectionPoint;
 }
 
-vector<Coord> combineIntersection(vector<Coord> a, vector<Coord> b){
-	for(int i = 0; i < b.size(); i++){
-		a.push_back(b.at(i));
+void drawCannon(Frame* frm,Coord loc,RGB color){
+	plotLine(frm,loc.x-10,loc.y-10,loc.x-10,loc.y+30,color);
+	plotLine(frm,loc.x-10,loc.y+30,loc.x+10,loc.y+30,color);
+	plotLine(frm,loc.x+10,loc.y+30,loc.x+10,loc.y-10,color);
+	plotLine(frm,loc.x+10,loc.y-10,loc.x-10,loc.y-10,color);	
+	plotHalfCircle(frm,loc.x,loc.y-10,10,color);
+	loc.y=loc.y-20;
+	plotLine(frm,loc.x-5,loc.y-5,loc.x-5,loc.y+2,color);
+	//plotLine(loc.x-5,loc.y+5,loc.x+5,loc.y+5);
+	plotLine(frm,loc.x+5,loc.y+2,loc.x+5,loc.y-5,color);
+	plotLine(frm,loc.x+5,loc.y-5,loc.x-5,loc.y-5,color);	
+}
+
+
+void drawStickman(Frame* frm,Coord loc,int sel,RGB color,int counter){
+	plotCircle(frm,loc.x,loc.y,15,color);
+	plotLine(frm,loc.x,loc.y+15,loc.x,loc.y+50,color);
+	
+	if(counter % 2 == 0){
+		plotLine(frm,loc.x,loc.y+30,loc.x+20,loc.y+sel-3,color);
+		plotLine(frm,loc.x,loc.y+30,loc.x+25,loc.y+(sel+10)-3,color);
+	}else{
+		plotLine(frm,loc.x,loc.y+30,loc.x+20,loc.y+sel,color);
+		plotLine(frm,loc.x,loc.y+30,loc.x+25,loc.y+(sel+10),color);
+	}
+	
+	
+}
+
+void drawStickmanAndCannon(Frame *frame, Coord shipPosition, RGB color, int counter){
+	
+	if(counter % 2 == 0){
+		//Draw cannon
+		drawCannon(frame, coord(shipPosition.x, shipPosition.y - 80 - 3), rgb(99,99,99));
+	}else{
+		//Draw cannon
+		drawCannon(frame, coord(shipPosition.x, shipPosition.y - 80), rgb(99,99,99));
+	}
+		
+	//Draw stickman
+	drawStickman(frame, coord(shipPosition.x - 30, shipPosition.y - 90), 15, rgb(99,99,99),counter);
+}
+
+
+void drawFish(Frame  *frame, Coord center, RGB color) {
+	/*vector<Coord> fishCoord = getFishCoordinate(coord(center.x-30,center.y-20));
+	for(int i=0;i<fishCoord.size();++i) {
+		if(i!=fishCoord.size()-1)
+			plotLine(frame,fishCoord.at(i).x, fishCoord.at(i).y ,fishCoord.at(i+1).x, fishCoord.at(i+1).y, color);
+		else
+			plotLine(frame, fishCoord.at(i).x, fishCoord.at(i).y ,fishCoord.at(0).x, fishCoord.at(0).y, color);
+	}*/
+	
+	//panjang badan 12
+	//tinggi 10
+	//panjang moncong 10
+	//draw mulut
+	plotLine(frame, center.x -15, center.y -25, center.x -5, center.y -30, color);
+	plotLine(frame, center.x -15, center.y -25, center.x -5, center.y -20, color);
+	
+	//draw badan
+	plotLine(frame, center.x -5, center.y -30, center.x + 7, center.y -30, color);
+	plotLine(frame, center.x -5, center.y -20, center.x + 7, center.y -20, color);
+	
+	//draw pangkal ekor
+	plotLine(frame, center.x + 7, center.y -30, center.x + 7, center.y -26, color);
+	plotLine(frame, center.x + 7, center.y -20, center.x + 7, center.y -24, color);
+	
+	//draw ekor
+	plotLine(frame, center.x + 7, center.y -26, center.x + 14, center.y -30, color);
+	plotLine(frame, center.x + 7, center.y -24, center.x + 14, center.y -20, color);
+	plotLine(frame, center.x + 14, center.y -30, center.x + 14, center.y -20, color);
+}
+
+/* LAYERS -------------------------------------------------------------- */
+
+/* A layer is a surface of premultiplied BGRA pixels (alpha in the X byte)
+ * composited over a frame with source-over, for translucent effects drawn
+ * on top of the opaque world. Everything outside what was drawn on it this
+ * frame is kept transparent (0), and a coverage flag per layerTileWidth
+ * span of a row says whether the span is all clear, all opaque or mixed:
+ * clear spans are skipped, opaque ones copied, only mixed ones blended.
+ * Tiles are single rows so that bands (row ranges) never share a flag.
+ */
+enum { tileClear, tileOpaque, tileMixed };
+
+typedef struct s_layer {
+	Frame surface;
+	vector<unsigned char> coverage; // per row, one flag per tile
+	int tileColumns;
+} Layer;
+
+void newLayer(Layer* layer, int width, int height) {
+	layer->surface = newFrame(width, height);
+	fillRect(&layer->surface, layer->surface.clip, 0);
+	layer->tileColumns = (width + layerTileWidth - 1) / layerTileWidth;
+	layer->coverage.assign((size_t)layer->tileColumns * height, tileClear);
+}
+
+void freeLayer(Layer* layer) {
+	freeFrame(&layer->surface);
+}
+
+// rescan the alpha of every tile r touches
+void updateLayerCoverage(Layer* layer, Rect r) {
+	for (int y = r.y0; y < r.y1; y++) {
+		const uint32_t* row = frameRow(&layer->surface, y);
+		for (int t = r.x0 / layerTileWidth; t * layerTileWidth < r.x1; t++) {
+			int end = min((t + 1) * layerTileWidth, layer->surface.width);
+			uint32_t all = 0xFFFFFFFFu;
+			uint32_t any = 0;
+			for (int x = t * layerTileWidth; x < end; x++) {
+				all &= row[x];
+				any |= row[x];
+			}
+			layer->coverage[(size_t)y * layer->tileColumns + t] = !any ? tileClear : (all >> 24) == 0xFF ? tileOpaque : tileMixed;
+		}
+	}
+}
+
+/* Clear what was drawn on a view of the layer last frame, then start a new
+ * frame on it; the view's damage says what the layer holds, like a canvas.
+ */
+void clearLayer(Layer* layer, Frame* view) {
+	Damage* dmg = view->damage;
+	dmg->curCount = coalesceRects(dmg->cur, dmg->curCount);
+	for (int i = 0; i < dmg->curCount; i++) {
+		Rect r = dmg->cur[i];
+		fillRect(&layer->surface, r, 0);
+		for (int y = r.y0; y < r.y1; y++) {
+			unsigned char* flags = &layer->coverage[(size_t)y * layer->tileColumns];
+			memset(flags + r.x0 / layerTileWidth, tileClear, (r.x1 - 1) / layerTileWidth - r.x0 / layerTileWidth + 1);
+		}
+		dmg->pixelsTouched += rectArea(r);
+	}
+	nextDamageFrame(dmg);
+}
+
+// multiply the premultiplied pixels of r by alpha / 255
+void fadeRect(Frame* frm, Rect r, int alpha) {
+	r = rectIntersect(r, frm->clip);
+	for (int y = r.y0; y < r.y1; y++) {
+		uint32_t* row = frameRow(frm, y);
+		for (int x = r.x0; x < r.x1; x++) {
+			if (row[x]) row[x] = scalePixel(row[x], alpha);
+		}
+	}
+}
+
+// composite r of the layer over the same pixels of dst (the layer is dst-sized)
+void blendLayer(Frame* dst, Layer* layer, Rect r) {
+	r = rectIntersect(r, dst->clip);
+	if (isRectEmpty(r)) return;
+	markDirty(dst, r.x0, r.y0, r.x1 - 1, r.y1 - 1);
+	for (int y = r.y0; y < r.y1; y++) {
+		const unsigned char* flags = &layer->coverage[(size_t)y * layer->tileColumns];
+		uint32_t* dstRow = frameRow(dst, y);
+		const uint32_t* srcRow = frameRow(&layer->surface, y);
+		for (int t = r.x0 / layerTileWidth; t * layerTileWidth < r.x1; t++) {
+			if (flags[t] == tileClear) continue;
+			int x0 = max(t * layerTileWidth, r.x0);
+			int x1 = min((t + 1) * layerTileWidth, r.x1);
+			if (flags[t] == tileOpaque) memcpy(dstRow + x0, srcRow + x0, (x1 - x0) * sizeof(uint32_t));
+			else kernels.blendRow(dstRow + x0, srcRow + x0, x1 - x0);
+		}
+	}
+}
+
+// rescan and composite everything drawn on a view of the layer this frame
+void composeLayer(Frame* dst, Layer* layer, Frame* view) {
+	Damage* dmg = view->damage;
+	dmg->curCount = coalesceRects(dmg->cur, dmg->curCount);
+	for (int i = 0; i < dmg->curCount; i++) {
+		updateLayerCoverage(layer, dmg->cur[i]);
+		blendLayer(dst, layer, dmg->cur[i]);
+		dmg->pixelsTouched += rectArea(dmg->cur[i]);
+	}
+}
+
+/* SHAPE TABLES -------------------------------------------------------- */
+
+/* Outlines are built at compile time: vertices (prefix-summed where the
+ * shape is given as steps), bounds and the sorted edge table fillPolygon
+ * would otherwise build every call. Drawing one only translates it.
+ */
+#define countOf(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+constexpr Outline finishOutline(Outline o) {
+	o.bounds = Rect{o.vertex[0].x, o.vertex[0].y, o.vertex[0].x + 1, o.vertex[0].y + 1};
+	for (int i = 1; i < o.count; i++) {
+		o.bounds.x0 = min(o.bounds.x0, o.vertex[i].x);
+		o.bounds.y0 = min(o.bounds.y0, o.vertex[i].y);
+		o.bounds.x1 = max(o.bounds.x1, o.vertex[i].x + 1);
+		o.bounds.y1 = max(o.bounds.y1, o.vertex[i].y + 1);
+	}
+
+	o.edgeCount = 0;
+	for (int i = 0; i < o.count; i++) {
+		Coord a = o.vertex[i];
+		Coord b = o.vertex[(i + 1) % o.count];
+		if (a.y == b.y) continue; // horizontal edges are covered by their neighbours
+		if (a.y > b.y) { Coord t = a; a = b; b = t; }
+		Edge e = {a.y, b.y, a.x * 65536, (b.x - a.x) * 65536 / (b.y - a.y)};
+
+		// insertion sort by top scanline
+		int j = o.edgeCount++;
+		while (j > 0 && o.edge[j-1].yTop > e.yTop) {
+			o.edge[j] = o.edge[j-1];
+			j--;
+		}
+		o.edge[j] = e;
+	}
+	return o;
+}
+
+constexpr Outline outlineFromVertices(const Coord* vertex, int count) {
+	Outline o = {};
+	o.count = count;
+	for (int i = 0; i < count; i++) o.vertex[i] = vertex[i];
+	return finishOutline(o);
+}
+
+// the first step is the start vertex, every other one is relative to the previous vertex
+constexpr Outline outlineFromSteps(const Coord* step, int count) {
+	Outline o = {};
+	o.count = count;
+	o.vertex[0] = step[0];
+	for (int i = 1; i < count; i++) {
+		o.vertex[i] = Coord{o.vertex[i-1].x + step[i].x, o.vertex[i-1].y + step[i].y};
+	}
+	return finishOutline(o);
+}
+
+constexpr bool isOutlineEqual(const Outline& o, const Coord* vertex, int count) {
+	if (o.count != count) return false;
+	for (int i = 0; i < count; i++) {
+		if (o.vertex[i].x != vertex[i].x || o.vertex[i].y != vertex[i].y) return false;
+	}
+	return true;
+}
+
+// Ship's border, relative to the middle of its keel
+constexpr int panjangDekBawah = 100;
+constexpr int deltaDekAtasBawah = 60;
+constexpr int tinggiKapal = 40;
+constexpr int jarakKeUjung = panjangDekBawah / 2 + deltaDekAtasBawah / 2;
+constexpr Coord shipVertices[] = {
+	{-jarakKeUjung, -tinggiKapal},
+	{jarakKeUjung, -tinggiKapal},
+	{-jarakKeUjung + panjangDekBawah + deltaDekAtasBawah/2, 0},
+	{-jarakKeUjung + deltaDekAtasBawah/2, 0},
+};
+constexpr Outline shipOutline = outlineFromVertices(shipVertices, countOf(shipVertices));
+
+// Plane's border, relative to its nose
+constexpr Coord planeSteps[] = {
+	{0, 0}, {15, -5}, {30, -3}, {13, -4}, {13, -3}, {13, 3}, {13, 4}, {50, -3}, {5, -18}, {10, -4},
+	{3, 27}, {-1, 5}, {1, 5}, {-67, 3}, {13, 25}, {-10, -6}, {-17, -18}, {-37, -1}, {-27, -3},
+};
+constexpr Outline planeOutline = outlineFromSteps(planeSteps, countOf(planeSteps));
+
+// Fish body as drawn by drawFish
+constexpr Coord fishBodyVertices[] = {
+	{-15, -25}, {-5, -30}, // mulut
+	{7, -30}, {7, -26},    // pangkal ekor
+	{14, -30}, {14, -20},  // ekor
+	{7, -24}, {7, -20}, {-5, -20},
+};
+constexpr Outline fishBodyOutline = outlineFromVertices(fishBodyVertices, countOf(fishBodyVertices));
+
+// Pattern shapes for filling hulls
+constexpr Coord fishSteps[] = {
+	{0, 0}, {7, -3}, {10, -2}, {15, -1}, {15, 1}, {12, 3}, {7, 0}, {6, -6},
+	{0, 12}, {-6, -5}, {-7, 2}, {-12, 3}, {-15, 1}, {-15, -1}, {-10, -2},
+};
+constexpr Outline fishOutline = outlineFromSteps(fishSteps, countOf(fishSteps));
+
+constexpr Coord birdSteps[] = {
+	{0, 0}, {10, -5}, {10, 5}, {5, 5}, {20, 5}, {5, 0},
+	{-10, 5}, {-10, 0}, {-10, -2}, {-10, -2}, {-10, -2}, {-10, -2},
+};
+constexpr Outline birdOutline = outlineFromSteps(birdSteps, countOf(birdSteps));
+
+// the outlines the old push_back code produced
+constexpr Coord shipExpected[] = {{-80, -40}, {80, -40}, {50, 0}, {-50, 0}};
+constexpr Coord planeExpected[] = {
+	{0, 0}, {15, -5}, {45, -8}, {58, -12}, {71, -15}, {84, -12}, {97, -8}, {147, -11}, {152, -29}, {162, -33},
+	{165, -6}, {164, -1}, {165, 4}, {98, 7}, {111, 32}, {101, 26}, {84, 8}, {47, 7}, {20, 4},
+};
+constexpr Coord fishExpected[] = {
+	{0, 0}, {7, -3}, {17, -5}, {32, -6}, {47, -5}, {59, -2}, {66, -2}, {72, -8},
+	{72, 4}, {66, -1}, {59, 1}, {47, 4}, {32, 5}, {17, 4}, {7, 2},
+};
+constexpr Coord birdExpected[] = {
+	{0, 0}, {10, -5}, {20, 0}, {25, 5}, {45, 10}, {50, 10}, {40, 15}, {30, 15}, {20, 13}, {10, 11}, {0, 9}, {-10, 7},
+};
+static_assert(isOutlineEqual(shipOutline, shipExpected, countOf(shipExpected)), "ship outline changed");
+static_assert(isOutlineEqual(planeOutline, planeExpected, countOf(planeExpected)), "plane outline changed");
+static_assert(isOutlineEqual(fishOutline, fishExpected, countOf(fishExpected)), "fish outline changed");
+static_assert(isOutlineEqual(birdOutline, birdExpected, countOf(birdExpected)), "bird outline changed");
+static_assert(shipOutline.edgeCount == 2 && shipOutline.bounds.x0 == -80 && shipOutline.bounds.y1 == 1, "ship edge table");
+static_assert(fishBodyOutline.edgeCount == 7, "fish body edge table");
+
+/* FUNCTIONS FOR SCANLINE ALGORITHM ---------------------------------------------------- */
+
+bool isSlopeEqualsZero(int y0, int y1){
+	if(y0 == y1){
+		return true;
+	}else{
+		return false;
+	}
+}
+
+bool isInBetween(int y0, int y1, int yTest){
+	if((yTest >= y0 && yTest <= y1 || yTest >= y1 && yTest <= y0) && !isSlopeEqualsZero(y0, y1)){
+		return true;
+	}else{
+		return false;
+	}
+}
+
+/* Function to calculate intersection between line (a,b) and line with slope 0 */
+Coord intersection(Coord a, Coord b, int y){
+	int x;
+	double slope;
+	
+	if(b.x == a.x){
+		x = a.x;
+	}else{
+		slope = (double)(b.y - a.y) / (double)(b.x - a.x);
+		x = round(((double)(y - a.y) / slope) + (double)a.x);
+	}
+	
+	return coord(x, y);
+}
+
+bool compareByAxis(const s_coord &a, const s_coord &b){
+	return a.x < b.x;
+}
+
+bool compareSameAxis(const s_coord &a, const s_coord &b){
+	return a.x == b.x;
+}
+
+vector<Coord> intersectionGenerator(int y, const vector<Coord>& polygon){
+	vector<Coord> intersectionPoint;
+	
+	for(int i = 0; i < polygon.size(); i++){
+		if(i == polygon.size() - 1){
+			if(isInBetween(polygon.at(i).y, polygon.at(0).y, y)){				
+				Coord a = coord(polygon.at(i).x, polygon.at(i).y);
+				Coord b = coord(polygon.at(0).x, polygon.at(0).y);
+				
+				intersectionPoint.push_back(intersection(a, b, y));
+			}
+		}else{
+			if(isInBetween(polygon.at(i).y, polygon.at(i + 1).y, y)){
+				Coord a = coord(polygon.at(i).x, polygon.at(i).y);
+				Coord b = coord(polygon.at(i + 1).x, polygon.at(i + 1).y);
+				
+				intersectionPoint.push_back(intersection(a, b, y));
+			}
+		}
+	}
+	
+	sort(intersectionPoint.begin(), intersectionPoint.end(), compareByAxis);
+	
+	return intersectionPoint;
+}
+
+vector<Coord> combineIntersection(vector<Coord> a, const vector<Coord>& b){
+	for(int i = 0; i < b.size(); i++){
+		a.push_back(b.at(i));
+	}
+	
+	sort(a.begin(), a.end(), compareByAxis);
+	
+	return a;
+}
+
+/* Polygon fill with an edge table and an active edge list.
+ * Edges are sorted by their top scanline once; each scanline then only
+ * steps the active edges' x in 16.16 fixed point and fills between pairs
+ * (even-odd), so the cost follows the filled pixels instead of
+ * pixels * edges. Edges cover the half-open range [yTop, yBottom).
+ */
+bool compareEdgeByTop(const Edge &a, const Edge &b){
+	return a.yTop < b.yTop;
+}
+
+/* A pattern is a pre-rasterized tile repeated over a fill instead of a
+ * solid color, anchored to the shape so it moves with it. Width and height
+ * are powers of two, and every tile row is stored twice over: a span
+ * starting anywhere in the tile is copied in tile-wide chunks from one row
+ * pointer, with a mask per span and no wrap or modulo per pixel.
+ */
+typedef struct s_pattern {
+	Frame tile;    // BGRX, 2 * width wide
+	Frame indexed; // the same tile as palette indices, for indexed frames
+	int width;
+	int height;
+} Pattern;
+
+// count pixels of the pattern anchored at at, to row y of frm from x
+void fillPatternSpan(Frame* frm, int x, int y, int count, const Pattern* pat, Coord at) {
+	int u = (x - at.x) & (pat->width - 1);
+	int v = (y - at.y) & (pat->height - 1);
+	if (frm->index) {
+		const unsigned char* src = pat->indexed.index + (size_t)v * pat->indexed.stride + u;
+		unsigned char* dst = indexRow(frm, y) + x;
+		for (; count > 0; count -= pat->width, dst += pat->width) memcpy(dst, src, min(count, pat->width));
+		return;
+	}
+	const uint32_t* src = pat->tile.px + (size_t)v * pat->tile.stride + u;
+	uint32_t* dst = frameRow(frm, y) + x;
+	for (; count > 0; count -= pat->width, dst += pat->width) memcpy(dst, src, min(count, pat->width) * sizeof(uint32_t));
+}
+
+/* fill an edge table (sorted by yTop) translated by at, with px or, if
+ * pattern isn't NULL, with the pattern anchored at at; the caller marks the damage
+ */
+void fillEdges(Frame* frm, const Edge* edgeTable, int edgeCount, Coord at, uint32_t px, const Pattern* pattern = NULL){
+	// reused between calls (per thread), so filling doesn't allocate once warmed up
+	static thread_local vector<Edge> activeEdges;
+	int i;
+
+	activeEdges.clear();
+	if (edgeCount == 0) return;
+
+	int yEnd = edgeTable[0].yBottom;
+	for (i = 1; i < edgeCount; i++) {
+		yEnd = max(yEnd, edgeTable[i].yBottom);
+	}
+	yEnd = min(yEnd + at.y, frm->clip.y1);
+	int y = max(edgeTable[0].yTop + at.y, frm->clip.y0);
+	int next = 0;
+
+	for (; y < yEnd; y++) {
+		// move edges starting on this scanline (or clipped above it) into the active list
+		while (next < edgeCount && edgeTable[next].yTop + at.y <= y) {
+			Edge e = edgeTable[next++];
+			e.yTop += at.y;
+			e.yBottom += at.y;
+			e.x += at.x * 65536 + (y - e.yTop) * e.dx;
+			activeEdges.push_back(e);
+		}
+
+		// drop finished edges, keep the rest sorted by x (insertion sort, the list is nearly sorted)
+		int count = 0;
+		for (i = 0; i < (int)activeEdges.size(); i++) {
+			if (activeEdges[i].yBottom > y) {
+				Edge e = activeEdges[i];
+				int j = count++;
+				while (j > 0 && activeEdges[j-1].x > e.x) {
+					activeEdges[j] = activeEdges[j-1];
+					j--;
+				}
+				activeEdges[j] = e;
+			}
+		}
+		activeEdges.resize(count);
+
+		// round ties inwards so the span never pokes out of the plotLine border
+		for (i = 0; i + 1 < count; i += 2) {
+			int xl = max((activeEdges[i].x + 32768) >> 16, frm->clip.x0);
+			int xr = min((activeEdges[i+1].x + 32767) >> 16, frm->clip.x1 - 1);
+			if (xl > xr) continue;
+			if (pattern) fillPatternSpan(frm, xl, y, xr - xl + 1, pattern, at);
+			else fillFrameSpan(frm, xl, y, px, xr - xl + 1);
+		}
+
+		for (i = 0; i < count; i++) {
+			activeEdges[i].x += activeEdges[i].dx;
+		}
+	}
+}
+
+// append the fill edges of a closed polygon (not yet sorted by yTop) and return its bounds
+Rect appendPolygonEdges(const vector<Coord>& polygon, vector<Edge>* edgeTable){
+	int n = polygon.size();
+	int i;
+	int xmin = polygon[0].x, xmax = polygon[0].x, ymin = polygon[0].y, ymax = polygon[0].y;
+	for (i = 1; i < n; i++) {
+		xmin = min(xmin, polygon[i].x);
+		xmax = max(xmax, polygon[i].x);
+		ymin = min(ymin, polygon[i].y);
+		ymax = max(ymax, polygon[i].y);
+	}
+
+	for (i = 0; i < n; i++) {
+		Coord a = polygon[i];
+		Coord b = polygon[(i + 1) % n];
+		if (a.y == b.y) continue; // horizontal edges are covered by their neighbours
+		if (a.y > b.y) { Coord t = a; a = b; b = t; }
+		Edge e;
+		e.yTop = a.y;
+		e.yBottom = b.y;
+		e.dx = (b.x - a.x) * 65536 / (b.y - a.y);
+		e.x = a.x * 65536;
+		edgeTable->push_back(e);
+	}
+	return rect(xmin, ymin, xmax + 1, ymax + 1);
+}
+
+// fill a polygon with px, or with pattern anchored at the frame origin
+void fillPolygonWith(Frame* frm, const vector<Coord>& polygon, uint32_t px, const Pattern* pattern){
+	static thread_local vector<Edge> edgeTable;
+
+	edgeTable.clear();
+	if (polygon.empty()) return;
+	Rect box = appendPolygonEdges(polygon, &edgeTable);
+	markDirty(frm, box.x0, box.y0, box.x1 - 1, box.y1 - 1);
+	if (edgeTable.empty()) return;
+	stable_sort(edgeTable.begin(), edgeTable.end(), compareEdgeByTop);
+	fillEdges(frm, &edgeTable[0], edgeTable.size(), coord(0, 0), px, pattern);
+}
+
+void fillPolygon(Frame* frm, const vector<Coord>& polygon, RGB color){
+	fillPolygonWith(frm, polygon, framePixel(frm, color), NULL);
+}
+
+void fillPolygonPattern(Frame* frm, const vector<Coord>& polygon, const Pattern* pattern){
+	fillPolygonWith(frm, polygon, 0, pattern);
+}
+
+// fill a compile-time outline with its anchor at loc
+void fillOutline(Frame* frm, const Outline* o, Coord loc, RGB color){
+	markDirty(frm, loc.x + o->bounds.x0, loc.y + o->bounds.y0, loc.x + o->bounds.x1 - 1, loc.y + o->bounds.y1 - 1);
+	fillEdges(frm, o->edge, o->edgeCount, loc, framePixel(frm, color));
+}
+
+// the same with a pattern, anchored at loc too
+void fillOutlinePattern(Frame* frm, const Outline* o, Coord loc, const Pattern* pattern){
+	markDirty(frm, loc.x + o->bounds.x0, loc.y + o->bounds.y0, loc.x + o->bounds.x1 - 1, loc.y + o->bounds.y1 - 1);
+	fillEdges(frm, o->edge, o->edgeCount, loc, 0, pattern);
+}
+
+// draw a compile-time outline's border with its anchor at loc
+void plotOutline(Frame* frm, const Outline* o, Coord loc, RGB color){
+	for (int i = 0; i < o->count; i++) {
+		Coord a = o->vertex[i];
+		Coord b = o->vertex[(i + 1) % o->count];
+		plotLine(frm, loc.x + a.x, loc.y + a.y, loc.x + b.x, loc.y + b.y, color);
+	}
+}
+
+/* COVERAGE RASTERIZER ------------------------------------------------- */
+
+/* Anti-aliased polygon fill by coverage accumulation, the way font
+ * rasterizers do it. Each edge adds to every cell (pixel) it crosses the
+ * signed area it covers there, and to the cell after it the winding it
+ * carries on along the row, so a running sum along a row gives every
+ * pixel's exact coverage; vertices may sit anywhere between pixels. Only
+ * touched cells are kept, sorted and swept once: between two of them the
+ * sum is constant, so runs inside the shape are filled solid and runs
+ * outside skipped without looking at them, and only pixels under an edge
+ * are blended, all in the same sweep. BGRX frames only, like layers.
+ */
+enum { fillEvenOdd, fillNonZero };
+
+typedef struct s_coverageCells {
+	Rect box;            // pixels of the polygon's bounds, rows clipped to the frame
+	int stride;          // cells per row: the box width and two more for the rightmost crossings
+	vector<float> area;     // per cell; all zero again after every sweep
+	vector<int> touched;    // cells written, in any order; again if one sums to 0 on the way
+	vector<int> touchedRow; // the row of each
+	vector<int> rowEnd;     // per row, into sorted
+	vector<int> sorted;     // touched by row and column
+} CoverageCells;
+
+inline void addCoverage(CoverageCells* c, int row, int cell, float area) {
+	if (c->area[cell] == 0) {
+		c->touched.push_back(cell);
+		c->touchedRow.push_back(row);
+	}
+	c->area[cell] += area;
+}
+
+// accumulate the edge a -> b, in cell coordinates (relative to the box)
+void accumulateEdge(CoverageCells* c, Point a, Point b) {
+	if (a.y == b.y) return;
+	float dir = 1;
+	if (a.y > b.y) {
+		Point t = a; a = b; b = t;
+		dir = -1;
+	}
+	float dxdy = (b.x - a.x) / (b.y - a.y);
+	float x = a.x;
+	float yTop = a.y;
+	float yBottom = min(b.y, (float)(c->box.y1 - c->box.y0));
+	if (yTop < 0) {
+		x -= yTop * dxdy;
+		yTop = 0;
+	}
+	for (int y = (int)yTop; y < yBottom; y++) {
+		float dy = min((float)(y + 1), yBottom) - max((float)y, yTop);
+		float xNext = x + dxdy * dy;
+		float d = dy * dir;
+		float xl = min(x, xNext);
+		float xr = max(x, xNext);
+		int left = (int)floorf(xl);
+		int right = (int)ceilf(xr);
+		int cell = y * c->stride + left;
+		if (right <= left + 1) {
+			// within one column: the part left of the crossing stays outside
+			float mid = 0.5f * (x + xNext) - left;
+			addCoverage(c, y, cell, d - d * mid);
+			addCoverage(c, y, cell + 1, d * mid);
+		} else {
+			// across columns: a triangle in the first, a trapezoid per column, a triangle in the last
+			float s = 1 / (xr - xl);
+			float leftFraction = xl - left;
+			float first = 0.5f * s * (1 - leftFraction) * (1 - leftFraction);
+			float rightFraction = xr - right + 1;
+			float last = 0.5f * s * rightFraction * rightFraction;
+			addCoverage(c, y, cell, d * first);
+			if (right == left + 2) {
+				addCoverage(c, y, cell + 1, d * (1 - first - last));
+			} else {
+				float second = s * (1.5f - leftFraction);
+				addCoverage(c, y, cell + 1, d * (second - first));
+				for (int i = 2; i < right - left - 1; i++) addCoverage(c, y, cell + i, d * s);
+				float beforeLast = second + (right - left - 3) * s;
+				addCoverage(c, y, y * c->stride + right - 1, d * (1 - beforeLast - last));
+			}
+			addCoverage(c, y, y * c->stride + right, d * last);
+		}
+		x = xNext;
+	}
+}
+
+// alpha of an accumulated winding under a fill rule
+inline int coverageAlpha(float winding, int rule) {
+	float a = fabsf(winding);
+	if (rule == fillEvenOdd) {
+		a -= 2 * floorf(a * 0.5f);
+		if (a > 1) a = 2 - a;
+	} else if (a > 1) {
+		a = 1;
+	}
+	return (int)(a * 255 + 0.5f);
+}
+
+// count pixels of a row at one alpha: solid, skipped, or blended
+inline void fillCoverageSpan(uint32_t* dst, int count, uint32_t px, int alpha) {
+	if (count <= 0 || alpha == 0) return;
+	if (alpha == 255) {
+		fillSpan(dst, px, count);
+		return;
+	}
+	uint32_t src = scalePixel(px, alpha);
+	for (int i = 0; i < count; i++) dst[i] = blendPixel(dst[i], src);
+}
+
+// sort the touched cells: counted into rows, then each row's few by insertion
+void sortCoverageCells(CoverageCells* c) {
+	int rows = c->box.y1 - c->box.y0;
+	size_t n = c->touched.size();
+	size_t i;
+	c->rowEnd.assign(rows + 1, 0);
+	for (i = 0; i < n; i++) c->rowEnd[c->touchedRow[i] + 1]++;
+	for (int row = 0; row < rows; row++) c->rowEnd[row + 1] += c->rowEnd[row];
+	c->sorted.resize(n);
+	for (i = 0; i < n; i++) c->sorted[c->rowEnd[c->touchedRow[i]]++] = c->touched[i];
+	for (int row = 0; row < rows; row++) {
+		for (int k = row ? c->rowEnd[row - 1] + 1 : 1; k < c->rowEnd[row]; k++) {
+			int cell = c->sorted[k];
+			int j = k;
+			for (; j > (row ? c->rowEnd[row - 1] : 0) && c->sorted[j - 1] > cell; j--) c->sorted[j] = c->sorted[j - 1];
+			c->sorted[j] = cell;
+		}
+	}
+}
+
+// sweep the touched cells row by row, blending as it goes, and zero them again
+void sweepCoverage(CoverageCells* c, Frame* frm, uint32_t px, int rule) {
+	sortCoverageCells(c);
+	// the columns drawn: inside the clip, and short of the cells past the box, which only cancel the winding out
+	int left = max(frm->clip.x0 - c->box.x0, 0);
+	int right = min(frm->clip.x1 - c->box.x0, c->box.x1 - c->box.x0);
+	int begin = 0;
+	for (int row = 0; row < c->box.y1 - c->box.y0; row++) {
+		int end = c->rowEnd[row];
+		uint32_t* dst = frameRow(frm, c->box.y0 + row) + c->box.x0;
+		float winding = 0;
+		int next = left; // first column not drawn yet
+		for (int k = begin; k < end; k++) {
+			int cell = c->sorted[k];
+			if (k > begin && cell == c->sorted[k - 1]) continue; // summed to 0 once and touched again
+			int column = min(cell - row * c->stride, right);
+			fillCoverageSpan(dst + next, column - next, px, coverageAlpha(winding, rule));
+			next = max(next, column);
+			winding += c->area[cell];
+			c->area[cell] = 0;
+			if (column >= left && column < right) {
+				int alpha = coverageAlpha(winding, rule);
+				if (alpha == 255) dst[column] = px;
+				else if (alpha) dst[column] = blendPixel(dst[column], scalePixel(px, alpha));
+				next = column + 1;
+			}
+		}
+		begin = end;
+	}
+	c->touched.clear();
+	c->touchedRow.clear();
+}
+
+// anti-aliased fill of a closed polygon, even-odd or non-zero
+void fillPolygonAA(Frame* frm, const vector<Point>& polygon, RGB color, int rule) {
+	static thread_local CoverageCells cells;
+	if (polygon.empty()) return;
+	float xmin = polygon[0].x, xmax = polygon[0].x, ymin = polygon[0].y, ymax = polygon[0].y;
+	size_t i;
+	for (i = 1; i < polygon.size(); i++) {
+		xmin = min(xmin, polygon[i].x);
+		xmax = max(xmax, polygon[i].x);
+		ymin = min(ymin, polygon[i].y);
+		ymax = max(ymax, polygon[i].y);
+	}
+	Rect bounds = rect((int)floorf(xmin), (int)floorf(ymin), (int)ceilf(xmax), (int)ceilf(ymax));
+	markDirty(frm, bounds.x0, bounds.y0, bounds.x1 - 1, bounds.y1 - 1);
+
+	// columns stay unclipped, so edges left of the clip still carry their winding into it
+	cells.box = rect(bounds.x0, max(bounds.y0, frm->clip.y0), bounds.x1, min(bounds.y1, frm->clip.y1));
+	if (cells.box.y0 >= cells.box.y1 || bounds.x0 >= frm->clip.x1 || bounds.x1 <= frm->clip.x0) return;
+	cells.stride = cells.box.x1 - cells.box.x0 + 2;
+	size_t needed = (size_t)cells.stride * (cells.box.y1 - cells.box.y0);
+	if (cells.area.size() < needed) cells.area.resize(needed, 0);
+
+	Point origin = point(cells.box.x0, cells.box.y0);
+	for (i = 0; i < polygon.size(); i++) {
+		Point a = polygon[i];
+		Point b = polygon[(i + 1) % polygon.size()];
+		accumulateEdge(&cells, point(a.x - origin.x, a.y - origin.y), point(b.x - origin.x, b.y - origin.y));
+	}
+	sweepCoverage(&cells, frm, packRGB(color), rule);
+}
+
+int isColorEqual(RGB color1, RGB color2){
+if (color1.r == color2.r && color1.g == color2.g && color1.b == color2.b){return 1;}
+else {return 0;}
+	}
+
+
+// old per-pixel recursive flood, kept only as the baseline for --bench-flood
+void colorFloodRecursive(Frame* frm,int x, int y,RGB color){
+	if (frameRow(frm, y)[x] == packRGB(color)){
+		//do nothing
+		}
+	else{
+		insertPixel(frm,coord(x,y),color);
+		colorFloodRecursive(frm,x+1,y,color);
+		colorFloodRecursive(frm,x,y+1,color);
+		colorFloodRecursive(frm,x-1,y,color);
+		colorFloodRecursive(frm,x,y-1,color);
+	}
+}
+
+// push one seed for every run of unfilled pixels in row y between xl and xr
+void floodScanRow(Frame* frm, int xl, int xr, int y, uint32_t px, vector<Coord>* seeds) {
+	if (y < frm->clip.y0 || y >= frm->clip.y1) return;
+	uint32_t* row = frameRow(frm, y);
+	int x = xl;
+	while (x <= xr) {
+		while (x <= xr && row[x] == px) x++;
+		if (x > xr) break;
+		seeds->push_back(coord(x, y));
+		while (x <= xr && row[x] != px) x++;
+	}
+}
+
+/* Span flood fill (4-connected, bounded by pixels already in fill color).
+ * Fills whole horizontal runs at once and keeps pending seeds in a reused
+ * heap stack instead of the call stack, so big regions can't overflow it.
+ */
+void colorFlood(Frame* frm,int x, int y,RGB color){
+	TRACE_SCOPE("colorFlood");
+	static thread_local vector<Coord> seeds; // kept between calls, so no allocation once warmed up
+	uint32_t px = packRGB(color);
+
+	if (x < frm->clip.x0 || x >= frm->clip.x1 || y < frm->clip.y0 || y >= frm->clip.y1) return;
+	seeds.clear();
+	seeds.push_back(coord(x, y));
+	int xmin = x, xmax = x, ymin = y, ymax = y;
+
+	while (!seeds.empty()) {
+		Coord seed = seeds.back();
+		seeds.pop_back();
+		uint32_t* row = frameRow(frm, seed.y);
+		if (row[seed.x] == px) continue;
+
+		// grow the run to both sides, then fill it
+		int xl = seed.x;
+		int xr = seed.x;
+		while (xl > frm->clip.x0 && row[xl-1] != px) xl--;
+		while (xr < frm->clip.x1-1 && row[xr+1] != px) xr++;
+		for (int i = xl; i <= xr; i++) {
+			row[i] = px;
+		}
+		xmin = min(xmin, xl);
+		xmax = max(xmax, xr);
+		ymin = min(ymin, seed.y);
+		ymax = max(ymax, seed.y);
+
+		floodScanRow(frm, xl, xr, seed.y - 1, px, &seeds);
+		floodScanRow(frm, xl, xr, seed.y + 1, px, &seeds);
+	}
+	markDirty(frm, xmin, ymin, xmax, ymax);
+}
+
+/* Function to draw ship */
+void drawShip(Frame *frame, Coord center, RGB color)
+{
+	plotOutline(frame, &shipOutline, center, color);
+}
+
+
+void drawAmmunition(Frame *frame, Coord upperBoundPosition, int ammunitionWidth, int ammunitionLength, RGB color){
+	plotLine(frame, upperBoundPosition.x, upperBoundPosition.y, upperBoundPosition.x, upperBoundPosition.y + ammunitionLength, color);
+	
+	int i;
+	for(i = 0; i < ammunitionWidth; i++){
+		plotLine(frame, upperBoundPosition.x + i, upperBoundPosition.y, upperBoundPosition.x + i, upperBoundPosition.y + ammunitionLength, color);
+		plotLine(frame, upperBoundPosition.x - i, upperBoundPosition.y, upperBoundPosition.x - i, upperBoundPosition.y + ammunitionLength, color);
+	}	
+}
+
+void drawPeluru(Frame *frame, Coord center, RGB color)
+{
+	int panjangPeluru = 10;
+	//DrawKiri
+	plotLine(frame, center.x - 3, center.y + panjangPeluru / 2, center.x -3, center.y - panjangPeluru / 2, color); 
+	
+	//DrawKanan
+	plotLine(frame, center.x + 3, center.y + panjangPeluru / 2, center.x + 3, center.y - panjangPeluru / 2, color);
+	
+	//DrawBawah
+	plotLine(frame, center.x - 3, center.y + panjangPeluru / 2, center.x +3, center.y + panjangPeluru / 2, color);
+	
+	//DrawUjungKiri
+	plotLine(frame, center.x - 3, center.y - panjangPeluru / 2, center.x, center.y - (panjangPeluru / 2 + 4), color);
+	
+	//DrawUjungKanan
+	plotLine(frame, center.x + 3, center.y - panjangPeluru / 2, center.x, center.y - (panjangPeluru / 2 + 4), color);
+}
+
+void drawPlane(Frame *frame, Coord position, RGB color) {
+	TRACE_SCOPE("drawPlane");
+	plotOutline(frame, &planeOutline, position, color);
+}
+
+void drawBird(Frame* frm, Coord loc,RGB color){
+	TRACE_SCOPE("drawBird");
+	plotHalfCircle(frm,loc.x,loc.y,10,color);
+	plotHalfCircle(frm,loc.x+20,loc.y,10,color);
+	plotHalfCircle(frm,loc.x,loc.y,5,color);
+	plotHalfCircle(frm,loc.x+20,loc.y,5,color);
+	plotLine(frm,loc.x+10,loc.y,loc.x+5,loc.y,color);
+	plotLine(frm,loc.x-10,loc.y,loc.x-5,loc.y,color);
+	plotLine(frm,loc.x+15,loc.y,loc.x+10,loc.y,color);
+	plotLine(frm,loc.x+25,loc.y,loc.x+30,loc.y,color);
+	}
+
+// fill the wings drawBird leaves open, e.g. to cut the bird out of a filled plane
+void fillBirdWings(Frame* frm, Coord loc, RGB color){
+	fillHalfRing(frm,loc.x,loc.y,10,5,color);
+	fillHalfRing(frm,loc.x+20,loc.y,10,5,color);
+}
+
+void drawExplosion(Frame *frame, Coord loc, int mult, RGB color){	
+	plotLine(frame,loc.x+10*mult,loc.y +10*mult,loc.x+20*mult,loc.y+20*mult,color);
+	plotLine(frame,loc.x-10*mult,loc.y -10*mult,loc.x-20*mult,loc.y-20*mult,color);
+	plotLine(frame,loc.x+10*mult,loc.y -10*mult,loc.x+20*mult,loc.y-20*mult,color);
+	plotLine(frame,loc.x-10*mult,loc.y +10*mult,loc.x-20*mult,loc.y+20*mult,color);
+	plotLine(frame,loc.x,loc.y -10*mult,loc.x,loc.y-20*mult,color);
+	plotLine(frame,loc.x-10*mult,loc.y,loc.x-20*mult,loc.y,color);
+	plotLine(frame,loc.x+10*mult,loc.y ,loc.x+20*mult,loc.y,color);
+	plotLine(frame,loc.x,loc.y +10*mult,loc.x,loc.y+20*mult,color);
+}
+
+// how much of the explosion is left as it grows
+int explosionAlpha(int explosionMul){
+	return max(255-explosionMul*12, 0);
+}
+
+// on a layer: the rays are drawn opaque and faded out as the explosion grows
+void animateExplosion(Frame* frame, int explosionMul, Coord loc){
+	int reach = 20*explosionMul;
+	drawExplosion(frame, loc, explosionMul, rgb(255, 0, 0));
+	fadeRect(frame, rect(loc.x-reach, loc.y-reach, loc.x+reach+1, loc.y+reach+1), explosionAlpha(explosionMul));
+}
+
+void drawBomb(Frame *frame, Coord center, RGB color)
+{
+	int panjangBomb = 10;
+	//DrawKiri
+	plotLine(frame, center.x - 3, center.y + panjangBomb / 2, center.x -3, center.y - panjangBomb / 2, color); 
+	
+	//DrawKanan
+	plotLine(frame, center.x + 3, center.y + panjangBomb / 2, center.x + 3, center.y - panjangBomb / 2, color);
+	
+	//DrawAtas
+	plotLine(frame, center.x - 3, center.y - panjangBomb / 2, center.x +3, center.y - panjangBomb / 2, color);
+	
+	//DrawUjungKiri
+	plotLine(frame, center.x - 3, center.y + panjangBomb / 2, center.x, center.y + (panjangBomb / 2 + 4), color);
+	
+	//DrawUjungKanan
+	plotLine(frame, center.x + 3, center.y + panjangBomb / 2, center.x, center.y + (panjangBomb / 2 + 4), color);
+}
+
+/* SPRITE CACHE -------------------------------------------------------- */
+
+// A horizontal run of same-colored pixels, relative to the sprite's anchor
+typedef struct s_spriteRun {
+	short x;
+	short y;
+	short len;
+	uint32_t px;
+	unsigned char index; // px in the palette, for indexed frames
+} SpriteRun;
+
+/* A shape rasterized once and stored as runs, row by row. Only covered
+ * pixels are stored, so a blit costs about the sprite's area and anything
+ * the shape doesn't cover is left alone.
+ */
+typedef struct s_sprite {
+	vector<SpriteRun> runs;
+	Rect bounds; // relative to the anchor
+} Sprite;
+
+// Shapes that never change, only move; colors are baked in
+typedef struct s_spriteCache {
+	int ready;
+	Pattern fishPattern; // ship hull fill
+	Pattern birdPattern; // plane hull fill
+	Sprite ship;         // hull filled with fish
+	Sprite stickman[2];  // stickman and cannon, by stickman counter parity
+	Sprite plane;        // hull filled with birds, the bird emblem cut out
+	Sprite bomb;
+	Sprite peluru;
+} SpriteCache;
+
+SpriteCache sprites;
+
+// a width x height tile (powers of two) of background with motif filled in at loc
+void makePattern(Pattern* pat, int width, int height, RGB background, const Outline* motif, Coord loc, RGB color) {
+	pat->width = width;
+	pat->height = height;
+	pat->tile = newFrame(2 * width, height);
+	Frame first = frameView(&pat->tile, rect(0, 0, width, height), NULL);
+	flushFrame(&first, background);
+	fillOutline(&first, motif, loc, color);
+	pat->indexed = newIndexedFrame(2 * width, height);
+	for (int y = 0; y < height; y++) {
+		uint32_t* row = frameRow(&pat->tile, y);
+		memcpy(row + width, row, width * sizeof(uint32_t));
+		for (int x = 0; x < 2 * width; x++) indexRow(&pat->indexed, y)[x] = paletteIndex(row[x]);
+	}
+}
+
+void drawShipSprite(Frame* frm, Coord loc, int /*variant*/) {
+	drawShip(frm, loc, rgb(99,99,99));
+	fillOutlinePattern(frm, &shipOutline, loc, &sprites.fishPattern);
+}
+
+void drawStickmanSprite(Frame* frm, Coord loc, int variant) {
+	drawStickmanAndCannon(frm, loc, rgb(99,99,99), variant);
+}
+
+void drawPlaneSprite(Frame* frm, Coord loc, int /*variant*/) {
+	drawPlane(frm, loc, rgb(99, 99, 99));
+	drawBird(frm, coord(loc.x+60, loc.y), rgb(99,99,99));
+	fillOutlinePattern(frm, &planeOutline, loc, &sprites.birdPattern);
+	fillBirdWings(frm, coord(loc.x+60, loc.y), rgb(0,0,0));
+}
+
+void drawBombSprite(Frame* frm, Coord loc, int /*variant*/) {
+	drawBomb(frm, loc, rgb(99, 99, 99));
+}
+
+void drawPeluruSprite(Frame* frm, Coord loc, int /*variant*/) {
+	drawPeluru(frm, loc, rgb(99, 99, 99));
+}
+
+// draw a shape once on a scratch frame and keep its runs
+void rasterizeSprite(Sprite* s, void (*draw)(Frame*, Coord, int), int variant) {
+	const int size = 512;
+	const int anchor = size / 2;
+	Frame scratch = newFrame(size, size);
+	fillRect(&scratch, scratch.clip, 0); // packRGB never yields 0, so 0 is "not covered"
+	draw(&scratch, coord(anchor, anchor), variant);
+
+	s->runs.clear();
+	s->bounds = rect(0, 0, 0, 0);
+	for (int y = 0; y < size; y++) {
+		uint32_t* row = frameRow(&scratch, y);
+		int x = 0;
+		while (x < size) {
+			if (!row[x]) { x++; continue; }
+			SpriteRun run;
+			run.x = x - anchor;
+			run.y = y - anchor;
+			run.px = row[x];
+			run.index = paletteIndex(run.px);
+			while (x < size && row[x] == run.px) x++;
+			run.len = x - anchor - run.x;
+			s->runs.push_back(run);
+			Rect r = rect(run.x, run.y, run.x + run.len, run.y + 1);
+			s->bounds = isRectEmpty(s->bounds) ? r : rectUnion(s->bounds, r);
+		}
+	}
+	freeFrame(&scratch);
+}
+
+// rasterize every sprite; must run before drawGame, which only reads the cache
+void initSpriteCache() {
+	if (sprites.ready) return;
+	makePattern(&sprites.fishPattern, 128, 16, rgb(99,99,99), &fishOutline, coord(27, 9), rgb(87, 255, 92));
+	makePattern(&sprites.birdPattern, 64, 32, rgb(99,99,99), &birdOutline, coord(12, 8), rgb(255, 255, 255));
+	rasterizeSprite(&sprites.ship, drawShipSprite, 0);
+	rasterizeSprite(&sprites.stickman[0], drawStickmanSprite, 0);
+	rasterizeSprite(&sprites.stickman[1], drawStickmanSprite, 1);
+	rasterizeSprite(&sprites.plane, drawPlaneSprite, 0);
+	rasterizeSprite(&sprites.bomb, drawBombSprite, 0);
+	rasterizeSprite(&sprites.peluru, drawPeluruSprite, 0);
+	sprites.ready = 1;
+}
+
+// copy a sprite's runs onto frm with its anchor at loc, clipped to frm->clip
+void blitSprite(Frame* frm, const Sprite* s, Coord loc) {
+	Rect box = rect(loc.x + s->bounds.x0, loc.y + s->bounds.y0, loc.x + s->bounds.x1, loc.y + s->bounds.y1);
+	box = rectIntersect(box, frm->clip);
+	if (isRectEmpty(box)) return;
+	markDirty(frm, box.x0, box.y0, box.x1 - 1, box.y1 - 1);
+
+	// runs are sorted by row: binary search the first one inside box
+	size_t lo = 0, hi = s->runs.size();
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (loc.y + s->runs[mid].y < box.y0) lo = mid + 1;
+		else hi = mid;
+	}
+	for (size_t i = lo; i < s->runs.size(); i++) {
+		const SpriteRun* run = &s->runs[i];
+		int y = loc.y + run->y;
+		if (y >= box.y1) break;
+		int x0 = max(loc.x + run->x, box.x0);
+		int x1 = min(loc.x + run->x + run->len, box.x1);
+		if (x0 < x1) fillFrameSpan(frm, x0, y, frm->index ? run->index : run->px, x1 - x0);
+	}
+}
+
+/* PRESENT BACKENDS ---------------------------------------------------- */
+
+// Where finished frames go. Every backend exposes its memory as a FrameBuffer.
+// With two pages present draws into the hidden one and flip shows it.
+typedef struct s_backend {
+	const char* name;
+	FrameBuffer fb;
+	int fd; // -1 if the backend has no file
+	int pages; // screens in fb: 1, or 2 to double buffer
+	int backPage; // page present writes to
+	int pageLen; // bytes per page
+	struct fb_var_screeninfo var; // fbdev mode as opened, for panning
+	void (*present)(struct s_backend* be, Frame* frm);
+	void (*flip)(struct s_backend* be); // show everything presented since the last flip
+	void (*close)(struct s_backend* be);
+	int (*waitVsync)(struct s_backend* be); // 0 at the start of a vblank, -1 if the backend can't tell
+} Backend;
+
+template <class PF>
+void presentToFrameBuffer(Backend* be, Frame* frm) {
+	FrameBuffer page = be->fb;
+	page.ptr += (size_t)be->backPage * be->pageLen;
+	page.smemLen = be->pageLen;
+	showFrame<PF>(frm, &page, be->pages);
+}
+
+// the present specialization for a headless framebuffer depth, in the usual layout; NULL if there is none
+void (*presentFor(int bpp))(Backend*, Frame*) {
+	switch (bpp) {
+		case FormatXRGB8888::bits: return presentToFrameBuffer<FormatXRGB8888>;
+		case FormatRGB888::bits: return presentToFrameBuffer<FormatRGB888>;
+		case FormatRGB565::bits: return presentToFrameBuffer<FormatRGB565>;
+	}
+	return NULL;
+}
+
+// whether an fbdev mode stores pixels the way PF does: depth and every channel
+template <class PF>
+int isModeFormat(const struct fb_var_screeninfo* v) {
+	return v->bits_per_pixel == PF::bits
+		&& v->red.offset == PF::redOffset && v->red.length == PF::redLength
+		&& v->green.offset == PF::greenOffset && v->green.length == PF::greenLength
+		&& v->blue.offset == PF::blueOffset && v->blue.length == PF::blueLength;
+}
+
+// the present specialization for an fbdev mode, NULL if there is none
+void (*presentForMode(const struct fb_var_screeninfo* v))(Backend*, Frame*) {
+	if (isModeFormat<FormatXRGB8888>(v)) return presentToFrameBuffer<FormatXRGB8888>;
+	if (isModeFormat<FormatRGB888>(v)) return presentToFrameBuffer<FormatRGB888>;
+	if (isModeFormat<FormatRGB565>(v)) return presentToFrameBuffer<FormatRGB565>;
+	return NULL;
+}
+
+// install present (NULL: the framebuffer's format isn't supported)
+void setPresent(Backend* be, void (*present)(Backend*, Frame*)) {
+	be->present = present;
+	if (!be->present) {
+		printf("Error: %d bpp framebuffers are not supported (16 RGB565, 24 RGB888 or 32 XRGB8888).\n", be->fb.bpp);
+		exit(7);
+	}
+}
+
+int waitFbdevVsync(Backend* be) {
+	uint32_t crtc = 0;
+	return ioctl(be->fd, FBIO_WAITFORVSYNC, &crtc) ? -1 : 0;
+}
+
+int waitNoVsync(Backend* /*be*/) {
+	return -1;
+}
+
+// headless pages: nothing to show, just swap which one is drawn into
+void flipPages(Backend* be) {
+	be->backPage = (be->backPage + 1) % be->pages;
+}
+
+// pan the display to the page just presented, during vertical blank so it never tears
+void flipFbdev(Backend* be) {
+	if (be->pages < 2) return;
+	struct fb_var_screeninfo var = be->var;
+	var.xoffset = 0;
+	var.yoffset = be->backPage * var.yres;
+	var.activate = FB_ACTIVATE_VBL;
+	ioctl(be->fd, FBIOPAN_DISPLAY, &var);
+	flipPages(be);
+}
+
+void closeMappedBackend(Backend* be) {
+	munmap(be->fb.ptr, be->fb.smemLen);
+	close(be->fd);
+}
+
+// leave the console where it was panned to
+void closeFbdevBackend(Backend* be) {
+	if (be->pages > 1) ioctl(be->fd, FBIOPAN_DISPLAY, &be->var);
+	closeMappedBackend(be);
+}
+
+void closeMemoryBackend(Backend* be) {
+	free(be->fb.ptr);
+}
+
+// the real thing: mmap'd /dev/fb0 (or another fbdev node)
+void openFbdevBackend(Backend* be, const char* path) {
+	struct fb_var_screeninfo vInfo; // variable screen info
+	struct fb_fix_screeninfo sInfo; // static screen info
+	be->name = "fbdev";
+	be->fd = open(path,O_RDWR);
+	if (be->fd < 0) {
+		printf("Error: cannot open framebuffer device.\n");
+		exit(1);
+	}
+	if (ioctl (be->fd, FBIOGET_FSCREENINFO, &sInfo)) {
+		printf("Error reading fixed information.\n");
+		exit(2);
+	}
+	if (ioctl (be->fd, FBIOGET_VSCREENINFO, &vInfo)) {
+		printf("Error reading variable information.\n");
+		exit(3);
+	}
+	
+	// create the FrameBuffer struct with its important infos.
+	be->fb.smemLen = sInfo.smem_len;
+	be->fb.lineLen = sInfo.line_length;
+	be->fb.bpp = vInfo.bits_per_pixel;
+	screenX = vInfo.xres;
+	screenY = vInfo.yres;
+	
+	// and map the framebuffer to the FB struct.
+	be->fb.ptr = (char*)mmap(0, sInfo.smem_len, PROT_READ | PROT_WRITE, MAP_SHARED, be->fd, 0);
+	if (be->fb.ptr == MAP_FAILED) {
+		printf ("Error: failed to map framebuffer device to memory.\n");
+		exit(4);
+	}
+	
+	// double buffer if the virtual resolution holds two screens and the
+	// driver pans (checked by panning to where the display already is)
+	be->var = vInfo;
+	be->pages = 1;
+	be->backPage = 0;
+	be->pageLen = sInfo.line_length * vInfo.yres;
+	if (vInfo.yres_virtual >= 2 * vInfo.yres && sInfo.smem_len >= 2 * (unsigned)be->pageLen && sInfo.ypanstep
+			&& ioctl(be->fd, FBIOPAN_DISPLAY, &vInfo) == 0) {
+		be->pages = 2;
+		be->backPage = vInfo.yoffset < vInfo.yres; // the page not on screen
+	}
+	setPresent(be, presentForMode(&vInfo));
+	be->flip = flipFbdev;
+	be->close = closeFbdevBackend;
+	be->waitVsync = waitFbdevVsync;
+}
+
+// headless: frames land in plain memory
+void openMemoryBackend(Backend* be, int height, int lineLen, int bpp, int pages) {
+	be->name = "memory";
+	be->fd = -1;
+	be->pages = pages;
+	be->backPage = 0;
+	be->pageLen = lineLen * height;
+	be->fb.smemLen = be->pageLen * pages;
+	be->fb.lineLen = lineLen;
+	be->fb.bpp = bpp;
+	be->fb.ptr = (char*)calloc(be->fb.smemLen, 1);
+	if (!be->fb.ptr) {
+		printf("Error: cannot allocate memory framebuffer.\n");
+		exit(5);
+	}
+	setPresent(be, presentFor(be->fb.bpp));
+	be->flip = flipPages;
+	be->close = closeMemoryBackend;
+	be->waitVsync = waitNoVsync;
+}
+
+// headless, but inspectable: a regular file mmap'd like a framebuffer device
+void openFileBackend(Backend* be, const char* path, int height, int lineLen, int bpp, int pages) {
+	be->name = "file";
+	be->fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (be->fd < 0 || ftruncate(be->fd, (off_t)lineLen * height * pages)) {
+		printf("Error: cannot create fake framebuffer %s.\n", path);
+		exit(1);
+	}
+	be->pages = pages;
+	be->backPage = 0;
+	be->pageLen = lineLen * height;
+	be->fb.smemLen = be->pageLen * pages;
+	be->fb.lineLen = lineLen;
+	be->fb.bpp = bpp;
+	be->fb.ptr = (char*)mmap(0, be->fb.smemLen, PROT_READ | PROT_WRITE, MAP_SHARED, be->fd, 0);
+	if (be->fb.ptr == MAP_FAILED) {
+		printf ("Error: failed to map fake framebuffer to memory.\n");
+		exit(4);
+	}
+	setPresent(be, presentFor(be->fb.bpp));
+	be->flip = flipPages;
+	be->close = closeMappedBackend;
+	be->waitVsync = waitNoVsync;
+}
+
+/* COLLISION ----------------------------------------------------------- */
+
+/* Uniform-grid broad phase. Every collider is bucketed into the cells its
+ * box overlaps (a counting sort, rebuilt from scratch each tick), then each
+ * cell tests its colliders against each other. Only colliders that want to
+ * hit something (hitMask) start a test, so a few targets among many
+ * projectiles cost one pass over each target's cells, not all pairs.
+ */
+typedef struct s_collider {
+	Rect box;
+	int id;           // caller's index, e.g. into the projectile pool
+	unsigned layer;   // what this is
+	unsigned hitMask; // layers it collides with
+} Collider;
+
+typedef struct s_collisionPair {
+	int a; // collider indices; a's hitMask contains b's layer
+	int b;
+} CollisionPair;
+
+typedef struct s_collisionGrid {
+	Rect area; // colliders outside are clamped into the border cells
+	int cellSize;
+	int columns;
+	int rows;
+	vector<Collider> colliders;
+	vector<int> cellStart; // colliders of cell c: cellItems[cellStart[c] .. cellStart[c+1])
+	vector<int> cellItems;
+	vector<CollisionPair> pairs;
+} CollisionGrid;
+
+// (re)start an empty grid over area; cheap enough for every tick, the vectors keep their memory
+void initCollisionGrid(CollisionGrid* grid, Rect area, int cellSize) {
+	grid->area = area;
+	grid->cellSize = cellSize;
+	grid->columns = max((area.x1 - area.x0 + cellSize - 1) / cellSize, 1);
+	grid->rows = max((area.y1 - area.y0 + cellSize - 1) / cellSize, 1);
+	grid->colliders.clear();
+	grid->pairs.clear();
+}
+
+int addCollider(CollisionGrid* grid, Rect box, int id, unsigned layer, unsigned hitMask) {
+	Collider c;
+	c.box = box;
+	c.id = id;
+	c.layer = layer;
+	c.hitMask = hitMask;
+	grid->colliders.push_back(c);
+	return grid->colliders.size() - 1;
+}
+
+int cellColumn(const CollisionGrid* grid, int x) {
+	return min(max(x - grid->area.x0, 0) / grid->cellSize, grid->columns - 1);
+}
+
+int cellRow(const CollisionGrid* grid, int y) {
+	return min(max(y - grid->area.y0, 0) / grid->cellSize, grid->rows - 1);
+}
+
+// bucket every collider into its cells
+void buildCollisionGrid(CollisionGrid* grid) {
+	int cells = grid->columns * grid->rows;
+	int n = grid->colliders.size();
+	int i, cx, cy;
+	grid->cellStart.assign(cells + 1, 0);
+
+	for (i = 0; i < n; i++) {
+		const Rect* b = &grid->colliders[i].box;
+		for (cy = cellRow(grid, b->y0); cy <= cellRow(grid, b->y1 - 1); cy++) {
+			for (cx = cellColumn(grid, b->x0); cx <= cellColumn(grid, b->x1 - 1); cx++) {
+				grid->cellStart[cy * grid->columns + cx + 1]++;
+			}
+		}
+	}
+	for (i = 0; i < cells; i++) grid->cellStart[i + 1] += grid->cellStart[i];
+
+	grid->cellItems.resize(grid->cellStart[cells]);
+	static thread_local vector<int> fill;
+	fill.assign(grid->cellStart.begin(), grid->cellStart.end() - 1);
+	for (i = 0; i < n; i++) {
+		const Rect* b = &grid->colliders[i].box;
+		for (cy = cellRow(grid, b->y0); cy <= cellRow(grid, b->y1 - 1); cy++) {
+			for (cx = cellColumn(grid, b->x0); cx <= cellColumn(grid, b->x1 - 1); cx++) {
+				grid->cellItems[fill[cy * grid->columns + cx]++] = i;
+			}
+		}
+	}
+}
+
+/* Narrow phase: every overlapping pair (a wants b) once. A pair sharing
+ * several cells is only reported from the cell holding the top-left corner
+ * of the overlap. Returns the number of pairs, left in grid->pairs.
+ */
+int findCollisions(CollisionGrid* grid) {
+	buildCollisionGrid(grid);
+	grid->pairs.clear();
+	const Collider* c = grid->colliders.data(); // NULL with no colliders, then never read
+	for (int cy = 0; cy < grid->rows; cy++) {
+		for (int cx = 0; cx < grid->columns; cx++) {
+			int cell = cy * grid->columns + cx;
+			int begin = grid->cellStart[cell];
+			int end = grid->cellStart[cell + 1];
+			for (int i = begin; i < end; i++) {
+				int a = grid->cellItems[i];
+				if (!c[a].hitMask) continue;
+				for (int j = begin; j < end; j++) {
+					int b = grid->cellItems[j];
+					if (a == b || !(c[a].hitMask & c[b].layer)) continue;
+					if ((c[b].hitMask & c[a].layer) && b < a) continue; // mutual, reported as (b, a)
+					Rect overlap = rectIntersect(c[a].box, c[b].box);
+					if (isRectEmpty(overlap)) continue;
+					if (cellColumn(grid, overlap.x0) != cx || cellRow(grid, overlap.y0) != cy) continue;
+					CollisionPair pair;
+					pair.a = a;
+					pair.b = b;
+					grid->pairs.push_back(pair);
+				}
+			}
+		}
+	}
+	return grid->pairs.size();
+}
+
+/* PROJECTILES --------------------------------------------------------- */
+
+enum { projectileBullet, projectileBomb };
+
+/* Bullets and bombs as structure-of-arrays, so the update pass is a flat
+ * loop over each field. Live projectiles are packed in [0, count): the
+ * update pass only flags the dead ones, compactProjectiles swaps them out.
+ */
+typedef struct s_projectilePool {
+	int capacity;
+	int count;
+	int* x;
+	int* y;
+	int* vx; // pixels per tick
+	int* vy;
+	unsigned char* kind;
+	unsigned char* alive;
+} ProjectilePool;
+
+void initProjectilePool(ProjectilePool* p, int capacity) {
+	p->capacity = capacity;
+	p->count = 0;
+	p->x = (int*)malloc(capacity * sizeof(int));
+	p->y = (int*)malloc(capacity * sizeof(int));
+	p->vx = (int*)malloc(capacity * sizeof(int));
+	p->vy = (int*)malloc(capacity * sizeof(int));
+	p->kind = (unsigned char*)malloc(capacity);
+	p->alive = (unsigned char*)malloc(capacity);
+	if (!p->x || !p->y || !p->vx || !p->vy || !p->kind || !p->alive) {
+		printf("Error: cannot allocate %d projectiles.\n", capacity);
+		exit(5);
+	}
+}
+
+void freeProjectilePool(ProjectilePool* p) {
+	free(p->x);
+	free(p->y);
+	free(p->vx);
+	free(p->vy);
+	free(p->kind);
+	free(p->alive);
+	p->capacity = p->count = 0;
+}
+
+// 0 if the pool is full
+int spawnProjectile(ProjectilePool* p, int kind, Coord at, int vx, int vy) {
+	if (p->count == p->capacity) return 0;
+	int i = p->count++;
+	p->x[i] = at.x;
+	p->y[i] = at.y;
+	p->vx[i] = vx;
+	p->vy[i] = vy;
+	p->kind[i] = kind;
+	p->alive[i] = 1;
+	return 1;
+}
+
+// move everything by one tick; whatever leaves area dies
+void updateProjectiles(ProjectilePool* p, Rect area) {
+	int n = p->count;
+	int* x = p->x;
+	int* y = p->y;
+	int i;
+	for (i = 0; i < n; i++) {
+		x[i] += p->vx[i];
+		y[i] += p->vy[i];
+	}
+	for (i = 0; i < n; i++) {
+		p->alive[i] = (x[i] >= area.x0) & (x[i] < area.x1) & (y[i] >= area.y0) & (y[i] < area.y1);
+	}
+}
+
+// drop the dead ones by moving the last live projectile into their slot
+void compactProjectiles(ProjectilePool* p) {
+	int i = 0;
+	while (i < p->count) {
+		if (p->alive[i]) { i++; continue; }
+		int last = --p->count;
+		p->x[i] = p->x[last];
+		p->y[i] = p->y[last];
+		p->vx[i] = p->vx[last];
+		p->vy[i] = p->vy[last];
+		p->kind[i] = p->kind[last];
+		p->alive[i] = p->alive[last];
+	}
+}
+
+// draw every projectile of one kind: its sprite and a trailLength trail below the tip
+void drawProjectiles(Frame* canvas, const ProjectilePool* p, int kind, int trailLength) {
+	const Sprite* s = kind == projectileBomb ? &sprites.bomb : &sprites.peluru;
+	// rows a projectile can touch relative to y; anything else is skipped before any work
+	int top = min(s->bounds.y0, 0);
+	int bottom = max(s->bounds.y1, trailLength + 1);
+	uint32_t trailPx = framePixel(canvas, rgb(99, 99, 99));
+	for (int i = 0; i < p->count; i++) {
+		if (p->kind[i] != kind) continue;
+		int x = p->x[i];
+		int y = p->y[i];
+		if (y + bottom <= canvas->clip.y0 || y + top >= canvas->clip.y1) continue;
+		blitSprite(canvas, s, coord(x, y));
+
+		// the pixels of drawAmmunition(canvas, coord(x, y), 3, trailLength, ...), as one rect
+		Rect trail = rectIntersect(rect(x - 2, y, x + 3, y + trailLength + 1), canvas->clip);
+		if (isRectEmpty(trail)) continue;
+		fillRect(canvas, trail, trailPx);
+		markDirty(canvas, trail.x0, trail.y0, trail.x1 - 1, trail.y1 - 1);
+	}
+}
+
+/* GAME ---------------------------------------------------------------- */
+
+// everything that moves
+typedef struct s_game {
+	int canvasWidth;
+	int canvasHeight;
+	Coord canvasPosition;
+	
+	int shipVelocity; // velocity (pixel/ loop)
+	int planeVelocity;
+	int shipXPosition;
+	int shipYPosition;
+	int planeXPosition;
+	int planeYPosition;
+	int MoveLeft;
+	int stickmanCounter;
+	
+	ProjectilePool projectiles;
+	CollisionGrid* collisions;
+	int ammunitionVelocity;
+	int ammunitionLength;
+	int ammunitionInterval; // ticks between two shots
+	int ammunitionCooldown;
+	int bombVelocity;
+	int bombInterval;
+	int bombCooldown;
+	
+	int isXploded;
+	int explosionMul;
+	Coord coordXplosion;
+
+	int cursorVisible; // set once the mouse sent something
+	Coord cursor;      // canvas space
+	int mouseButtons;
+} Game;
+
+void initGame(Game* g) {
+	memset(g, 0, sizeof(Game));
+	
+	// prepare canvas
+	g->canvasWidth = 1000;
+	g->canvasHeight = 500;
+	g->canvasPosition = coord(screenX/2,screenY/2);
+	
+	// prepare ship
+	g->shipVelocity = 5;
+	g->planeVelocity = 10;
+	
+	g->shipXPosition = g->canvasWidth - 80;
+	g->shipYPosition = 490;
+	g->planeXPosition = g->canvasWidth;
+	g->planeYPosition = 50;
+	g->MoveLeft = 1;
+	
+	initProjectilePool(&g->projectiles, maxProjectiles);
+	g->collisions = new CollisionGrid;
+	
+	// prepare ammunition: the next shot leaves once the last one is a third of the canvas up
+	g->ammunitionVelocity = 5;
+	g->ammunitionLength = 20;
+	g->ammunitionInterval = (g->shipYPosition - 120 - g->canvasHeight/3) / g->ammunitionVelocity;
+	g->ammunitionCooldown = g->ammunitionInterval;
+	spawnProjectile(&g->projectiles, projectileBullet, coord(g->shipXPosition, g->shipYPosition - 120), 0, -g->ammunitionVelocity);
+	
+	//prepare Bomb: one every third of the canvas height
+	g->bombVelocity = 10;
+	g->bombInterval = g->canvasHeight/3 / g->bombVelocity;
+	g->bombCooldown = g->bombInterval;
+	spawnProjectile(&g->projectiles, projectileBomb, coord(g->planeXPosition, g->planeYPosition + 120), 0, g->bombVelocity);
+}
+
+void freeGame(Game* g) {
+	freeProjectilePool(&g->projectiles);
+	delete g->collisions;
+}
+
+// collision layers
+enum { layerBullet = 1, layerBomb = 2, layerPlane = 4, layerShip = 8 };
+
+// hand every live projectile and both targets to the collision grid
+void addGameColliders(Game* g, CollisionGrid* grid, int* plane, int* ship) {
+	const ProjectilePool* pool = &g->projectiles;
+	initCollisionGrid(grid, rect(-projectileMargin, -projectileMargin, g->canvasWidth + projectileMargin, g->canvasHeight + projectileMargin), collisionCellSize);
+	// boxes hold what isInBound(p, corner1, corner2) accepted: strictly between the corners
+	*plane = addCollider(grid, rect(g->planeXPosition-4, g->planeYPosition-14, g->planeXPosition+170, g->planeYPosition+15), -1, layerPlane, layerBullet);
+	*ship = addCollider(grid, rect(g->shipXPosition-49, g->shipYPosition-99, g->shipXPosition+50, g->shipYPosition+30), -1, layerShip, layerBomb);
+	for (int i = 0; i < pool->count; i++) {
+		if (!pool->alive[i]) continue;
+		addCollider(grid, rect(pool->x[i], pool->y[i], pool->x[i] + 1, pool->y[i] + 1), i,
+			pool->kind[i] == projectileBomb ? layerBomb : layerBullet, 0);
+	}
+}
+
+// advance everything by one loop iteration
+void updateGame(Game* g) {
+	TRACE_SCOPE("updateGame");
+	g->stickmanCounter++;
+	g->planeXPosition -= g->planeVelocity;
+
+	// explosion in progress
+	if (g->isXploded == 1) {
+		g->explosionMul++;
+		if(g->explosionMul >= 20){
+			g->explosionMul = 0;
+			g->isXploded = 0;
+		}
+	}
+
+	// bullets and bombs
+	ProjectilePool* pool = &g->projectiles;
+	updateProjectiles(pool, rect(-projectileMargin, -projectileMargin, g->canvasWidth + projectileMargin, g->canvasHeight + projectileMargin));
+
+	if (--g->bombCooldown <= 0) {
+		spawnProjectile(pool, projectileBomb, coord(g->planeXPosition, g->planeYPosition + 15), 0, g->bombVelocity);
+		g->bombCooldown = g->bombInterval;
+	}
+	if (--g->ammunitionCooldown <= 0) {
+		spawnProjectile(pool, projectileBullet, coord(g->shipXPosition, g->shipYPosition - 120), 0, -g->ammunitionVelocity);
+		g->ammunitionCooldown = g->ammunitionInterval;
+	}
+
+	//explosion: bullets hit the plane, bombs hit the ship
+	int plane, ship;
+	CollisionGrid* grid = g->collisions;
+	addGameColliders(g, grid, &plane, &ship);
+	findCollisions(grid);
+
+	// one explosion at a time: at the first bullet (in pool order) on the plane, else the first bomb on the ship
+	int bulletHit = -1;
+	int bombHit = -1;
+	for (size_t i = 0; i < grid->pairs.size(); i++) {
+		int id = grid->colliders[grid->pairs[i].b].id;
+		if (grid->pairs[i].a == plane && (bulletHit < 0 || id < bulletHit)) bulletHit = id;
+		if (grid->pairs[i].a == ship && (bombHit < 0 || id < bombHit)) bombHit = id;
+	}
+	int hit = bulletHit >= 0 ? bulletHit : bombHit;
+	if (hit >= 0) {
+		g->coordXplosion = coord(pool->x[hit], pool->y[hit]);
+		g->isXploded = 1;
+	}
+	compactProjectiles(pool);
+
+	if(g->planeXPosition <= -170){
+		g->planeXPosition = g->canvasWidth;
+	}
+
+	if(g->planeXPosition == screenX/2 - g->canvasWidth/2 - 165){
+		g->planeXPosition = screenX/2 + g->canvasWidth/2;
+	}
+
+	if(g->shipXPosition == 80){
+		g->MoveLeft = 0;
+	}
+
+	if(g->shipXPosition == g->canvasWidth - 80){
+		g->MoveLeft = 1;
+	}
+
+	if(g->MoveLeft){
+		g->shipXPosition -= g->shipVelocity;
+	}else{
+		g->shipXPosition += g->shipVelocity;
+	}
+}
+
+/* Draw the current state onto the canvas. Only reads g (and the sprite
+ * cache), and every draw call clips to the canvas' clip rect, so it can run
+ * once per band in parallel.
+ */
+// the world on canvas, translucent effects through the effects layer (view: its rows of it), then the cursor
+void drawGame(const Game* g, Frame* canvas, Layer* effects, Frame* effectsView) {
+	TRACE_SCOPE("drawGame");
+	// draw ship and fish
+	blitSprite(canvas, &sprites.ship, coord(g->shipXPosition, g->shipYPosition));
+
+	// draw stickman and cannon
+	blitSprite(canvas, &sprites.stickman[g->stickmanCounter % 2], coord(g->shipXPosition, g->shipYPosition));
+
+	// draw plane and bird
+	blitSprite(canvas, &sprites.plane, coord(g->planeXPosition, g->planeYPosition));
+
+	// Plane Bomb
+	drawProjectiles(canvas, &g->projectiles, projectileBomb, g->ammunitionLength);
+
+	// stickman ammunition
+	drawProjectiles(canvas, &g->projectiles, projectileBullet, g->ammunitionLength);
+
+	if (g->isXploded == 1) {
+		// an indexed canvas can't hold blends: there the rays go straight on it, at their faded color
+		if (canvas->index) drawExplosion(canvas, g->coordXplosion, g->explosionMul, rgb(explosionAlpha(g->explosionMul), 0, 0));
+		else animateExplosion(effectsView, g->explosionMul, g->coordXplosion);
+	}
+	composeLayer(canvas, effects, effectsView);
+
+	if (g->cursorVisible) {
+		addBlob(canvas, g->cursor, g->mouseButtons ? rgb(255, 255, 0) : rgb(255, 255, 255));
+	}
+}
+
+/* WORKER POOL --------------------------------------------------------- */
+
+// Persistent threads that all run the same job, each with its own index.
+// The calling thread takes index 0, so a pool of 1 runs everything inline.
+typedef struct s_workerPool {
+	int count; // threads including the caller
+	vector<thread> threads;
+	mutex lock;
+	condition_variable wake;
+	condition_variable done;
+	long long generation;
+	int pending;
+	int quit;
+	void (*job)(void* arg, int index);
+	void* arg;
+} WorkerPool;
+
+void workerLoop(WorkerPool* pool, int index) {
+	long long seen = 0;
+	while (1) {
+		unique_lock<mutex> guard(pool->lock);
+		while (pool->generation == seen && !pool->quit) pool->wake.wait(guard);
+		if (pool->quit) return;
+		seen = pool->generation;
+		guard.unlock();
+
+		pool->job(pool->arg, index);
+
+		guard.lock();
+		if (--pool->pending == 0) pool->done.notify_one();
+	}
+}
+
+void startWorkerPool(WorkerPool* pool, int count) {
+	pool->count = max(count, 1);
+	pool->generation = 0;
+	pool->pending = 0;
+	pool->quit = 0;
+	for (int i = 1; i < pool->count; i++) {
+		pool->threads.push_back(thread(workerLoop, pool, i));
+	}
+}
+
+// run job(arg, 0..count-1) on all threads and wait for every one of them
+void runOnWorkers(WorkerPool* pool, void (*job)(void*, int), void* arg) {
+	{
+		lock_guard<mutex> guard(pool->lock);
+		pool->job = job;
+		pool->arg = arg;
+		pool->pending = pool->count - 1;
+		pool->generation++;
+	}
+	pool->wake.notify_all();
+	job(arg, 0);
+	unique_lock<mutex> guard(pool->lock);
+	while (pool->pending > 0) pool->done.wait(guard);
+}
+
+void stopWorkerPool(WorkerPool* pool) {
+	{
+		lock_guard<mutex> guard(pool->lock);
+		pool->quit = 1;
+	}
+	pool->wake.notify_all();
+	for (size_t i = 0; i < pool->threads.size(); i++) pool->threads[i].join();
+	pool->threads.clear();
+}
+
+/* COMMAND BUFFER ------------------------------------------------------ */
+
+/* Drawing recorded instead of done: every primitive is stored with the box
+ * it can touch (its damage is marked on the target right away, in the same
+ * order immediate mode would), then the commands are binned into
+ * commandTileWidth x commandTileHeight tiles and run tile by tile on views clipped to the tile.
+ * All recordable primitives clip exactly, so a tile gets the same pixels
+ * it would have gotten from the whole primitive, and each tile's pixels
+ * stay in cache while its commands run. Tiles are independent, so they
+ * can also be spread over a WorkerPool. Anything that reads pixels across
+ * tiles (colorFlood) can't be recorded: execute first, then draw it.
+ */
+enum { commandLine, commandCircle, commandFill, commandRect, commandBlit };
+
+typedef struct s_command {
+	int kind;
+	Rect box;        // clipped to the target; never empty
+	RGB color;
+	Coord a;         // line start, circle center, fill/blit anchor, rect corner
+	Coord b;         // line end, rect opposite corner (exclusive); circle radius in b.x
+	int edgeStart;   // fill: edges in the buffer's edge table
+	int edgeCount;
+	const Sprite* sprite;
+} Command;
+
+typedef struct s_commandBuffer {
+	Frame* target;
+	vector<Command> commands;
+	vector<Edge> edges; // fill edge tables, one sorted run per fill
+	int tileColumns;
+	int tileRows;
+	vector<int> binStart; // per tile, into binned; one more entry than there are tiles
+	vector<int> binned;   // command indices, in recording order within a tile
+	int workers;          // while executing on a pool
+} CommandBuffer;
+
+// start recording for frm; clip and damage are frm's at recording time
+void beginCommands(CommandBuffer* buf, Frame* frm) {
+	buf->target = frm;
+	buf->commands.clear();
+	buf->edges.clear();
+}
+
+// keep a command that touches box (half-open), if any of it is inside the target's clip
+void addCommand(CommandBuffer* buf, Command* cmd, Rect box) {
+	markDirty(buf->target, box.x0, box.y0, box.x1 - 1, box.y1 - 1);
+	cmd->box = rectIntersect(box, buf->target->clip);
+	if (!isRectEmpty(cmd->box)) buf->commands.push_back(*cmd);
+}
+
+void recordLine(CommandBuffer* buf, int x0, int y0, int x1, int y1, RGB color) {
+	Command cmd = Command();
+	cmd.kind = commandLine;
+	cmd.color = color;
+	cmd.a = coord(x0, y0);
+	cmd.b = coord(x1, y1);
+	addCommand(buf, &cmd, rect(min(x0,x1), min(y0,y1), max(x0,x1) + 1, max(y0,y1) + 1));
+}
+
+void recordCircle(CommandBuffer* buf, int xm, int ym, int r, RGB color) {
+	Command cmd = Command();
+	cmd.kind = commandCircle;
+	cmd.color = color;
+	cmd.a = coord(xm, ym);
+	cmd.b = coord(r, 0);
+	addCommand(buf, &cmd, rect(xm - r, ym - r, xm + r + 1, ym + r + 1));
+}
+
+void recordPolygon(CommandBuffer* buf, const vector<Coord>& polygon, RGB color) {
+	if (polygon.empty()) return;
+	Command cmd = Command();
+	cmd.kind = commandFill;
+	cmd.color = color;
+	cmd.a = coord(0, 0);
+	cmd.edgeStart = buf->edges.size();
+	Rect box = appendPolygonEdges(polygon, &buf->edges);
+	cmd.edgeCount = buf->edges.size() - cmd.edgeStart;
+	stable_sort(buf->edges.begin() + cmd.edgeStart, buf->edges.end(), compareEdgeByTop);
+	addCommand(buf, &cmd, box);
+}
+
+void recordOutline(CommandBuffer* buf, const Outline* o, Coord loc, RGB color) {
+	Command cmd = Command();
+	cmd.kind = commandFill;
+	cmd.color = color;
+	cmd.a = loc;
+	cmd.edgeStart = buf->edges.size();
+	cmd.edgeCount = o->edgeCount;
+	buf->edges.insert(buf->edges.end(), o->edge, o->edge + o->edgeCount);
+	addCommand(buf, &cmd, rect(loc.x + o->bounds.x0, loc.y + o->bounds.y0, loc.x + o->bounds.x1, loc.y + o->bounds.y1));
+}
+
+// a solid rect (a span if it is one row high)
+void recordRect(CommandBuffer* buf, Rect r, RGB color) {
+	Command cmd = Command();
+	cmd.kind = commandRect;
+	cmd.color = color;
+	addCommand(buf, &cmd, r);
+}
+
+void recordSprite(CommandBuffer* buf, const Sprite* s, Coord loc) {
+	Command cmd = Command();
+	cmd.kind = commandBlit;
+	cmd.a = loc;
+	cmd.sprite = s;
+	addCommand(buf, &cmd, rect(loc.x + s->bounds.x0, loc.y + s->bounds.y0, loc.x + s->bounds.x1, loc.y + s->bounds.y1));
+}
+
+// run one command on a tile view (no damage: it was marked when recording)
+void runCommand(CommandBuffer* buf, Frame* tile, const Command* cmd) {
+	switch (cmd->kind) {
+		case commandLine: plotLine(tile, cmd->a.x, cmd->a.y, cmd->b.x, cmd->b.y, cmd->color); break;
+		case commandCircle: plotCircle(tile, cmd->a.x, cmd->a.y, cmd->b.x, cmd->color); break;
+		case commandFill: fillEdges(tile, &buf->edges[cmd->edgeStart], cmd->edgeCount, cmd->a, framePixel(tile, cmd->color)); break;
+		case commandRect: fillRect(tile, rectIntersect(cmd->box, tile->clip), framePixel(tile, cmd->color)); break;
+		case commandBlit: blitSprite(tile, cmd->sprite, cmd->a); break;
+	}
+}
+
+int tileColumn(int x) {
+	return x / commandTileWidth;
+}
+
+int tileRow(int y) {
+	return y / commandTileHeight;
+}
+
+// sort the commands into tiles, a counting sort like buildCollisionGrid
+void binCommands(CommandBuffer* buf) {
+	Frame* frm = buf->target;
+	buf->tileColumns = tileColumn(frm->clip.x1 + commandTileWidth - 1);
+	buf->tileRows = tileRow(frm->clip.y1 + commandTileHeight - 1);
+	int tiles = buf->tileColumns * buf->tileRows;
+	buf->binStart.assign(tiles + 1, 0);
+	size_t i;
+	int x, y;
+
+	for (i = 0; i < buf->commands.size(); i++) {
+		Rect box = buf->commands[i].box;
+		for (y = tileRow(box.y0); y <= tileRow(box.y1 - 1); y++) {
+			for (x = tileColumn(box.x0); x <= tileColumn(box.x1 - 1); x++) buf->binStart[y * buf->tileColumns + x + 1]++;
+		}
+	}
+	for (int t = 0; t < tiles; t++) buf->binStart[t + 1] += buf->binStart[t];
+	buf->binned.resize(buf->binStart[tiles]);
+	vector<int> next(buf->binStart.begin(), buf->binStart.end() - 1);
+	for (i = 0; i < buf->commands.size(); i++) {
+		Rect box = buf->commands[i].box;
+		for (y = tileRow(box.y0); y <= tileRow(box.y1 - 1); y++) {
+			for (x = tileColumn(box.x0); x <= tileColumn(box.x1 - 1); x++) buf->binned[next[y * buf->tileColumns + x]++] = i;
+		}
+	}
+}
+
+void runTile(CommandBuffer* buf, int t) {
+	int x0 = (t % buf->tileColumns) * commandTileWidth;
+	int y0 = (t / buf->tileColumns) * commandTileHeight;
+	Frame tile = frameView(buf->target, rect(x0, y0, x0 + commandTileWidth, y0 + commandTileHeight), NULL);
+	for (int i = buf->binStart[t]; i < buf->binStart[t + 1]; i++) runCommand(buf, &tile, &buf->commands[buf->binned[i]]);
+}
+
+// worker index takes every workers-th tile
+void runTilesJob(void* arg, int index) {
+	CommandBuffer* buf = (CommandBuffer*)arg;
+	for (int t = index; t < buf->tileColumns * buf->tileRows; t += buf->workers) runTile(buf, t);
+}
+
+// draw everything recorded since beginCommands, on this thread or spread over pool
+void executeCommands(CommandBuffer* buf, WorkerPool* pool) {
+	binCommands(buf);
+	buf->workers = pool ? pool->count : 1;
+	if (pool) runOnWorkers(pool, runTilesJob, buf);
+	else runTilesJob(buf, 0);
+	buf->commands.clear();
+	buf->edges.clear();
+}
+
+/* RENDERER ------------------------------------------------------------ */
+
+/* Splits the screen into horizontal bands, one per worker. A band owns its
+ * rows of the composition frame and the canvas rows composited into them,
+ * each with its own damage, so composite, clear, draw and present of a band
+ * never touch another band's pixels and the result doesn't depend on the
+ * number of bands.
+ *
+ * Pipelined, the canvas is a ring of renderSlots surfaces. The workers draw
+ * frame N+1 into one while the present thread composites and presents
+ * frame N from another; a slot belongs to the workers from renderFrame
+ * until it is submitted, then to the present thread until it is presented.
+ * Both sides only count frames (submitted, presented), so the slot of a
+ * frame is its number modulo the ring size.
+ */
+typedef struct s_mouseInput MouseInput;
+void mouseInputPresented(MouseInput* in, long long readNs);
+
+typedef struct s_renderer {
+	Frame cFrame; // composition frame (Video RAM)
+	Frame canvas[renderSlots];
+	int slots; // 1: draw, composite and present in one pass on the workers
+	int bands;
+	vector<Damage> frameDamage;
+	vector<Damage> canvasDamage;    // per slot and band: what was drawn
+	vector<Damage> compositeDamage; // per band: canvas rows shown now and the frame before
+	vector<Frame> frameBands;  // views of cFrame
+	vector<Frame> canvasBands; // views of the canvases, same rows in canvas space, slot after slot
+	Layer effects; // one for all slots: it is drawn and composited within renderBand
+	vector<Damage> effectsDamage;
+	vector<Frame> effectsBands; // views of effects, the rows of canvasBands
+	WorkerPool pool;
+	Backend* backend;
+	const Game* game; // being drawn
+	int slot;         // being drawn
+	Coord canvasPosition;
+	int canvasWidth;
+	int canvasHeight;
+
+	thread presenter;
+	mutex lock;
+	condition_variable changed;
+	long long submitted; // frames drawn
+	long long presented; // frames on the framebuffer
+	int quit;
+	MouseInput* input;   // told when a frame showing its input is presented, may be NULL
+	long long inputNs[renderSlots]; // per slot: read time of the oldest input the frame shows, 0 if none
+} Renderer;
+
+void presentLoop(Renderer* r);
+
+void initRenderer(Renderer* r, Backend* backend, const Game* g, int bands, int pipelined, int indexed) {
+	r->cFrame = newFrame(screenX, screenY);
+	r->slots = pipelined ? renderSlots : 1;
+	for (int s = 0; s < r->slots; s++) {
+		r->canvas[s] = indexed ? newIndexedFrame(g->canvasWidth, g->canvasHeight) : newFrame(g->canvasWidth, g->canvasHeight);
+	}
+	r->bands = max(bands, 1);
+	r->backend = backend;
+	r->game = g;
+	r->slot = 0;
+	r->canvasPosition = g->canvasPosition;
+	r->canvasWidth = g->canvasWidth;
+	r->canvasHeight = g->canvasHeight;
+	initSpriteCache();
+	r->frameDamage.resize(r->bands);
+	r->canvasDamage.resize(r->slots * r->bands);
+	r->compositeDamage.resize(r->bands);
+	r->effectsDamage.resize(r->bands);
+	newLayer(&r->effects, g->canvasWidth, g->canvasHeight);
+
+	// balance the bands over the canvas rows; the first and last band also
+	// take the (static) screen rows above and below the canvas
+	int originY = g->canvasPosition.y - g->canvasHeight/2;
+	for (int b = 0; b < r->bands; b++) {
+		int y0 = b == 0 ? 0 : originY + g->canvasHeight * b / r->bands;
+		int y1 = b == r->bands - 1 ? screenY : originY + g->canvasHeight * (b + 1) / r->bands;
+		initDamage(&r->frameDamage[b]);
+		r->frameBands.push_back(frameView(&r->cFrame, rect(0, y0, screenX, y1), &r->frameDamage[b]));
+		flushFrame(&r->frameBands[b], rgb(33,33,33));
+	}
+	for (int s = 0; s < r->slots; s++) {
+		flushFrame(&r->canvas[s], rgb(0,0,0));
+		for (int b = 0; b < r->bands; b++) {
+			Rect rows = rect(0, r->frameBands[b].clip.y0 - originY, g->canvasWidth, r->frameBands[b].clip.y1 - originY);
+			initDamage(&r->canvasDamage[s * r->bands + b]);
+			r->canvasBands.push_back(frameView(&r->canvas[s], rows, &r->canvasDamage[s * r->bands + b]));
+			flushFrame(&r->canvasBands[s * r->bands + b], rgb(0,0,0));
+		}
+	}
+	for (int b = 0; b < r->bands; b++) {
+		initDamage(&r->effectsDamage[b]);
+		r->effectsBands.push_back(frameView(&r->effects.surface, r->canvasBands[b].clip, &r->effectsDamage[b]));
+	}
+	// the first composite copies the whole canvas
+	for (int b = 0; b < r->bands; b++) {
+		initDamage(&r->compositeDamage[b]);
+		Frame shown = frameView(&r->canvas[0], r->canvasBands[b].clip, &r->compositeDamage[b]);
+		markDirty(&shown, shown.clip.x0, shown.clip.y0, shown.clip.x1 - 1, shown.clip.y1 - 1);
+	}
+
+	startWorkerPool(&r->pool, r->bands);
+	r->submitted = 0;
+	r->presented = 0;
+	r->quit = 0;
+	r->input = NULL;
+	if (r->slots > 1) r->presenter = thread(presentLoop, r);
+}
+
+// wait until every submitted frame is on the framebuffer
+void finishFrames(Renderer* r) {
+	unique_lock<mutex> guard(r->lock);
+	while (r->presented < r->submitted) r->changed.wait(guard);
+}
+
+void freeRenderer(Renderer* r) {
+	if (r->slots > 1) {
+		{
+			lock_guard<mutex> guard(r->lock);
+			r->quit = 1;
+		}
+		r->changed.notify_all();
+		r->presenter.join();
+	}
+	stopWorkerPool(&r->pool);
+	for (int s = 0; s < r->slots; s++) freeFrame(&r->canvas[s]);
+	freeLayer(&r->effects);
+	freeFrame(&r->cFrame);
+}
+
+/* Composite one band of a finished canvas and present it. cFrame holds the
+ * canvas shown last, so only what either of the two frames drew differs.
+ */
+void presentBand(Renderer* r, int slot, int band) {
+	Frame* screenBand = &r->frameBands[band];
+	Damage* drawn = r->canvasBands[slot * r->bands + band].damage;
+	Damage* shown = &r->compositeDamage[band];
+	memcpy(shown->prev, shown->cur, sizeof(shown->cur));
+	shown->prevCount = shown->curCount;
+	memcpy(shown->cur, drawn->cur, sizeof(drawn->cur));
+	shown->curCount = drawn->curCount;
+	Frame canvasBand = frameView(&r->canvas[slot], r->canvasBands[slot * r->bands + band].clip, shown);
+
+	// the composition frame is never cleaned: the background outside the
+	// canvas doesn't change, and showCanvas overwrites whatever did change
+	showCanvas(screenBand, &canvasBand, r->canvasWidth, r->canvasHeight, r->canvasPosition, rgb(99,99,99), 1);
+
+	//show frame
+	r->backend->present(r->backend, screenBand);
+}
+
+// clear the band of the canvas being drawn and of the effects, only where they were drawn last, and draw the game
+void renderBand(void* arg, int band) {
+	Renderer* r = (Renderer*)arg;
+	Frame* canvasBand = &r->canvasBands[r->slot * r->bands + band];
+	flushDirty(canvasBand, rgb(0,0,0));
+	clearLayer(&r->effects, &r->effectsBands[band]);
+	drawGame(r->game, canvasBand, &r->effects, &r->effectsBands[band]);
+	if (r->slots == 1) presentBand(r, r->slot, band);
+}
+
+// the present thread: composite and present frames in order as they are submitted
+void presentLoop(Renderer* r) {
+	unique_lock<mutex> guard(r->lock);
+	while (1) {
+		while (r->presented == r->submitted && !r->quit) r->changed.wait(guard);
+		if (r->presented == r->submitted) return;
+		int slot = r->presented % r->slots;
+		guard.unlock();
+		{
+			TRACE_SCOPE("presentFrame");
+			for (int b = 0; b < r->bands; b++) presentBand(r, slot, b);
+			r->backend->flip(r->backend);
+		}
+		if (r->input) mouseInputPresented(r->input, r->inputNs[slot]);
+		guard.lock();
+		r->presented++;
+		r->changed.notify_all();
+	}
+}
+
+// inputNs: read time of the oldest input g shows, 0 if none; the frame is on screen when it returns unless pipelined
+void renderFrame(Renderer* r, const Game* g, long long inputNs) {
+	TRACE_SCOPE("renderFrame");
+	r->game = g;
+	if (r->slots == 1) {
+		runOnWorkers(&r->pool, renderBand, r);
+		r->backend->flip(r->backend);
+		r->submitted++;
+		r->presented++;
+		return;
+	}
+	{
+		// the next slot is free once the frame drawn in it last is presented
+		TRACE_SCOPE("waitForSlot");
+		unique_lock<mutex> guard(r->lock);
+		while (r->submitted - r->presented >= r->slots) r->changed.wait(guard);
+		r->slot = r->submitted % r->slots;
+	}
+	runOnWorkers(&r->pool, renderBand, r);
+	r->inputNs[r->slot] = inputNs;
+	{
+		lock_guard<mutex> guard(r->lock);
+		r->submitted++;
+	}
+	r->changed.notify_all();
+}
+
+void printRendererStats(Renderer* r, const char* indent) {
+	Damage frameTotal;
+	Damage canvasTotal;
+	Damage effectsTotal;
+	initDamage(&frameTotal);
+	initDamage(&canvasTotal);
+	initDamage(&effectsTotal);
+	for (int b = 0; b < r->bands; b++) {
+		frameTotal.pixelsTouched += r->frameDamage[b].pixelsTouched;
+		effectsTotal.pixelsTouched += r->effectsDamage[b].pixelsTouched;
+		canvasTotal.pixelsTouched += r->compositeDamage[b].pixelsTouched;
+		for (int s = 0; s < r->slots; s++) canvasTotal.pixelsTouched += r->canvasDamage[s * r->bands + b].pixelsTouched;
+	}
+	frameTotal.frames = r->frameDamage[0].frames;
+	effectsTotal.frames = r->effectsDamage[0].frames;
+	for (int s = 0; s < r->slots; s++) canvasTotal.frames += r->canvasDamage[s * r->bands].frames;
+
+	Frame cFrame = frameView(&r->cFrame, r->cFrame.clip, &frameTotal);
+	Frame canvas = frameView(&r->canvas[0], r->canvas[0].clip, &canvasTotal);
+	printf("%s", indent);
+	printDamageStats("canvas clear + composite", &canvas);
+	Frame effects = frameView(&r->effects.surface, r->effects.surface.clip, &effectsTotal);
+	printf("%s", indent);
+	printDamageStats("effects clear + blend", &effects);
+	printf("%s", indent);
+	printDamageStats("present", &cFrame);
+}
+
+/* FRAME PACING -------------------------------------------------------- */
+
+// monotonic clock in nanoseconds
+long long nowNs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Fixed-timestep simulation, decoupled from rendering: wall time is
+ * accumulated and spent in whole simulationHz ticks, so motion speed
+ * doesn't depend on how fast frames are drawn. Between frames the loop
+ * sleeps until the next frame is due, or waits for vblank with --vsync.
+ */
+typedef struct s_framePacer {
+	long long tickNs;        // one simulation step
+	long long frameNs;       // target frame interval, 0 = wake for every simulation tick
+	long long lastNs;
+	long long accumulatorNs; // wall time not yet simulated
+	long long nextFrameNs;   // deadline of the next frame
+	int vsync;               // wait for vblank instead of sleeping; cleared if the device can't
+} FramePacer;
+
+void initFramePacer(FramePacer* p, int fps, int vsync) {
+	p->tickNs = 1000000000LL / simulationHz;
+	p->frameNs = fps > 0 ? 1000000000LL / fps : 0;
+	p->lastNs = nowNs();
+	p->accumulatorNs = 0;
+	p->nextFrameNs = p->lastNs + p->frameNs;
+	p->vsync = vsync;
+}
+
+// number of simulation ticks due since the last call
+int dueTicks(FramePacer* p) {
+	long long now = nowNs();
+	p->accumulatorNs += now - p->lastNs;
+	p->lastNs = now;
+	int ticks = p->accumulatorNs / p->tickNs;
+	p->accumulatorNs -= (long long)ticks * p->tickNs;
+	if (ticks > maxCatchUpTicks) ticks = maxCatchUpTicks; // after a stall, drop time instead of fast-forwarding
+	return ticks;
+}
+
+// sleep until the monotonic clock reads ns
+void sleepUntil(long long ns) {
+	struct timespec deadline;
+	deadline.tv_sec = ns / 1000000000LL;
+	deadline.tv_nsec = ns % 1000000000LL;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR); // a signal lands here; the loop checks for quit right after
+}
+
+/* Block until the next frame should start. Without a frame rate that is
+ * when the next simulation tick is due: a frame drawn any sooner would
+ * show nothing new.
+ */
+void waitNextFrame(FramePacer* p, Backend* backend) {
+	TRACE_SCOPE("waitNextFrame");
+	if (p->vsync) {
+		if (backend->waitVsync(backend) == 0) return;
+		printf("Warning: %s backend can't wait for vsync, pacing with a timer.\n", backend->name);
+		p->vsync = 0;
+	}
+	if (!p->frameNs) {
+		sleepUntil(p->lastNs + p->tickNs - p->accumulatorNs);
+		return;
+	}
+
+	long long now = nowNs();
+	if (p->nextFrameNs < now - p->frameNs) p->nextFrameNs = now; // too late to catch up, restart the schedule
+	sleepUntil(p->nextFrameNs);
+	p->nextFrameNs += p->frameNs;
+}
+
+/* INPUT THREAD -------------------------------------------------------- */
+
+// cursor and buttons after one PS/2 packet, stamped when it was read
+typedef struct s_mouseState {
+	Coord cursor; // screen space
+	int buttons;  // bit 0 left, bit 1 right, bit 2 middle
+	long long readNs;
+} MouseState;
+
+/* Single-producer/single-consumer ring: the input thread only moves head,
+ * the main loop only moves tail, so neither ever waits for the other. When
+ * the ring is full new states are dropped; states are absolute, so the next
+ * one that fits makes up for them.
+ */
+typedef struct s_inputRing {
+	MouseState slot[inputRingSize];
+	atomic<unsigned> head; // next slot to write
+	atomic<unsigned> tail; // next slot to read
+} InputRing;
+
+int pushInput(InputRing* ring, const MouseState* m) {
+	unsigned head = ring->head.load(memory_order_relaxed);
+	if (head - ring->tail.load(memory_order_acquire) == inputRingSize) return 0;
+	ring->slot[head % inputRingSize] = *m;
+	ring->head.store(head + 1, memory_order_release);
+	return 1;
+}
+
+int popInput(InputRing* ring, MouseState* m) {
+	unsigned tail = ring->tail.load(memory_order_relaxed);
+	if (tail == ring->head.load(memory_order_acquire)) return 0;
+	*m = ring->slot[tail % inputRingSize];
+	ring->tail.store(tail + 1, memory_order_release);
+	return 1;
+}
+
+typedef struct s_mouseInput {
+	int fd;      // the mouse device, or a FIFO standing in for it
+	int wake[2]; // pipe to interrupt poll on shutdown
+	atomic<int> quit; // also checked every mouseQuitPollMs, in case the wake can't be written
+	thread reader;
+	InputRing ring;
+	Coord counter; // mouse internal counter, owned by the reader
+	long long dropped;
+
+	// main loop side: the oldest state read since the last frame was rendered
+	long long unshownNs; // its read time, 0 if none
+
+	// present side: latency from reading a packet to presenting the frame that shows it
+	long long frames;
+	long long latencySumNs;
+	long long latencyMaxNs;
+} MouseInput;
+
+// decode one PS/2 packet into the reader's counter and button state
+void decodeMousePacket(MouseInput* in, const unsigned char* pkt, MouseState* m) {
+	int dx = pkt[1] - ((pkt[0] << 4) & 0x100); // 9-bit two's complement, sign in the header
+	int dy = pkt[2] - ((pkt[0] << 3) & 0x100);
+	in->counter.x += dx;
+	in->counter.y -= dy; // PS/2 y points up
+	m->cursor = getCursorCoord(&in->counter);
+	m->buttons = pkt[0] & 0x07;
+}
+
+void mouseReaderLoop(MouseInput* in) {
+	unsigned char buf[3 * 64];
+	unsigned char pkt[3];
+	int have = 0;
+	struct pollfd fds[2];
+	fds[0].fd = in->fd;
+	fds[0].events = POLLIN;
+	fds[1].fd = in->wake[0];
+	fds[1].events = POLLIN;
+
+	while (!in->quit.load(memory_order_acquire)) {
+		int ready = poll(fds, 2, mouseQuitPollMs);
+		if (ready < 0) {
+			if (errno == EINTR) continue;
+			return;
+		}
+		if (ready == 0) continue;
+		if (fds[1].revents) return;
+		if (!(fds[0].revents & POLLIN)) continue;
+
+		int n = read(in->fd, buf, sizeof(buf));
+		if (n <= 0) continue;
+		long long now = nowNs();
+		for (int i = 0; i < n; i++) {
+			if (have == 0 && !(buf[i] & 0x08)) continue; // not a header byte: resync
+			pkt[have++] = buf[i];
+			if (have < 3) continue;
+			have = 0;
+			MouseState m;
+			decodeMousePacket(in, pkt, &m);
+			m.readNs = now;
+			if (!pushInput(&in->ring, &m)) in->dropped++;
+		}
+	}
+}
+
+/* Start reading mouse packets from path on their own thread. A FIFO works
+ * as a stand-in device; it's opened read-write so it never reports EOF
+ * when its writer goes away. Returns 0 if path can't be opened.
+ */
+int startMouseInput(MouseInput* in, const char* path) {
+	struct stat st;
+	int fifo = stat(path, &st) == 0 && S_ISFIFO(st.st_mode);
+	in->fd = open(path, (fifo ? O_RDWR : O_RDONLY) | O_NONBLOCK);
+	if (in->fd < 0) return 0;
+	if (pipe(in->wake)) {
+		close(in->fd);
+		return 0;
+	}
+	in->ring.head = 0;
+	in->ring.tail = 0;
+	in->counter = coord(screenX/2 * mouseSensitivity, screenY/2 * mouseSensitivity);
+	in->dropped = 0;
+	in->unshownNs = 0;
+	in->frames = 0;
+	in->latencySumNs = 0;
+	in->latencyMaxNs = 0;
+	in->quit = 0;
+	in->reader = thread(mouseReaderLoop, in);
+	return 1;
+}
+
+// the reader is always joined before its fds are closed and in can be freed
+void stopMouseInput(MouseInput* in) {
+	in->quit.store(1, memory_order_release);
+	while (write(in->wake[1], "q", 1) < 0 && (errno == EINTR || errno == EAGAIN)); // else the reader sees quit on its next timeout
+	in->reader.join();
+	close(in->wake[0]);
+	close(in->wake[1]);
+	close(in->fd);
+}
+
+// take every state the reader published; 0 if nothing new
+int pollMouseInput(MouseInput* in, MouseState* latest) {
+	int got = 0;
+	MouseState m;
+	while (popInput(&in->ring, &m)) {
+		if (!in->unshownNs) in->unshownNs = m.readNs;
+		*latest = m;
+		got = 1;
+	}
+	return got;
+}
+
+// read time of the oldest state taken since the last call, for the frame about to be rendered; 0 if none
+long long takeUnshownInput(MouseInput* in) {
+	long long readNs = in->unshownNs;
+	in->unshownNs = 0;
+	return readNs;
+}
+
+// a frame was presented: the input it showed, read at readNs (0: none), is now on screen
+void mouseInputPresented(MouseInput* in, long long readNs) {
+	if (!readNs) return;
+	long long latency = nowNs() - readNs;
+	in->frames++;
+	in->latencySumNs += latency;
+	in->latencyMaxNs = max(in->latencyMaxNs, latency);
+}
+
+void printMouseInputStats(MouseInput* in) {
+	if (!in->frames) return;
+	printf("input: %lld frames with mouse input, read to present %.2f ms avg, %.2f ms max, %lld states dropped\n",
+		in->frames, in->latencySumNs / 1e6 / in->frames, in->latencyMaxNs / 1e6, in->dropped);
+}
+
+/* BENCHMARKS ---------------------------------------------------------- */
+
+// FNV-1a over all pixels, to check that two renderers agree
+unsigned long frameChecksum(Frame* frm) {
+	unsigned long hash = 2166136261UL;
+	int x, y;
+	for (y=0; y<frm->height; y++) {
+		for (x=0; x<frm->width; x++) {
+			hash = (hash ^ (frm->index ? indexRow(frm, y)[x] : frameRow(frm, y)[x])) * 16777619UL;
+		}
+	}
+	return hash;
+}
+
+// replay main()'s ship, fish and plane/bird drawing, timing only the fills
+long long timeFloodScene(Frame* cnvs, Coord ship, Coord plane, void (*fill)(Frame*,int,int,RGB)) {
+	long long spent = 0;
+	long long start;
+
+	flushFrame(cnvs, rgb(0,0,0));
+	drawShip(cnvs, ship, rgb(99,99,99));
+	start = nowNs();
+	fill(cnvs, ship.x, ship.y-1, rgb(99,99,99));
+	spent += nowNs() - start;
+
+	drawFish(cnvs, coord(ship.x + 20, ship.y), rgb(87, 255, 92));
+	start = nowNs();
+	fill(cnvs, ship.x + 20, ship.y - 25, rgb(87, 255, 92));
+	spent += nowNs() - start;
+	drawFish(cnvs, coord(ship.x - 20, ship.y), rgb(87, 255, 92));
+	start = nowNs();
+	fill(cnvs, ship.x - 20, ship.y - 25, rgb(87, 255, 92));
+	spent += nowNs() - start;
+
+	drawPlane(cnvs, plane, rgb(99, 99, 99));
+	drawBird(cnvs, coord(plane.x+60, plane.y), rgb(99,99,99));
+	start = nowNs();
+	fill(cnvs, plane.x+59, plane.y, rgb(99,99,99));
+	spent += nowNs() - start;
+
+	return spent;
+}
+
+// --bench-flood [iterations]: recursive vs span flood on the in-game fills
+int benchFlood(int iterations) {
+	Frame canvas = newFrame(screenX, screenY);
+	Frame* cnvs = &canvas;
+	Coord ship = coord(500, 490);
+	Coord plane = coord(400, 50);
+	long long recursiveNs = 0;
+	long long spanNs = 0;
+	unsigned long recursiveSum = 0;
+	unsigned long spanSum = 0;
+	int i;
+
+	for (i=0; i<iterations; i++) {
+		recursiveNs += timeFloodScene(cnvs, ship, plane, colorFloodRecursive);
+		if (i == 0) recursiveSum = frameChecksum(cnvs);
+
+		spanNs += timeFloodScene(cnvs, ship, plane, colorFlood);
+		if (i == 0) spanSum = frameChecksum(cnvs);
+	}
+
+	printf("flood fill, %d frames (ship + 2 fish + plane/bird)\n", iterations);
+	printf("  recursive: %10.1f us/frame\n", recursiveNs / 1000.0 / iterations);
+	printf("  span:      %10.1f us/frame  (%.1fx)\n", spanNs / 1000.0 / iterations, (double)recursiveNs / spanNs);
+	printf("  output %s\n", recursiveSum == spanSum ? "identical" : "DIFFERS");
+
+	freeFrame(cnvs);
+	return recursiveSum == spanSum ? 0 : 1;
+}
+
+// plotLine as it was before clipping: a bounds check and an RGB per pixel
+void plotLineChecked(Frame* frm, int x0, int y0, int x1, int y1, RGB lineColor) {
+	int dx =  abs(x1-x0), sx = x0<x1 ? 1 : -1;
+	int dy = -abs(y1-y0), sy = y0<y1 ? 1 : -1; 
+	int err = dx+dy, e2; /* error value e_xy */
+	int loop = 1;
+	markDirty(frm, min(x0,x1), min(y0,y1), max(x0,x1), max(y0,y1));
+	while(loop){  /* loop */
+		insertPixel(frm, coord(x0, y0), rgb(lineColor.r, lineColor.g, lineColor.b));
+		if (x0==x1 && y0==y1) loop = 0;
+		e2 = 2*err;
+		if (e2 >= dy) { err += dy; x0 += sx; } /* e_xy+e_x > 0 */
+		if (e2 <= dx) { err += dx; y0 += sy; } /* e_xy+e_y < 0 */
+	}
+}
+
+// draw the same pseudo-random lines (game-sized, a quarter of them axis aligned) into a band
+long long timeLines(Frame* band, int count, void (*line)(Frame*,int,int,int,int,RGB)) {
+	unsigned int seed = 12345;
+	long long start = nowNs();
+	for (int i = 0; i < count; i++) {
+		seed = seed * 1103515245u + 12345u;
+		int x0 = (seed >> 8) % (screenX + 100) - 50;
+		seed = seed * 1103515245u + 12345u;
+		int y0 = (seed >> 8) % (screenY + 100) - 50;
+		seed = seed * 1103515245u + 12345u;
+		int x1 = x0 + (int)((seed >> 8) % 121) - 60;
+		seed = seed * 1103515245u + 12345u;
+		int y1 = y0 + (int)((seed >> 8) % 121) - 60;
+		if (i % 8 == 0) y1 = y0;
+		if (i % 8 == 1) x1 = x0;
+		line(band, x0, y0, x1, y1, rgb(i & 0xFF, 99, 99));
+	}
+	return nowNs() - start;
+}
+
+// --bench-lines [n]: lines per second of the per-pixel checked plotLine vs the clipped one
+int benchLines(int count) {
+	Frame frm = newFrame(screenX, screenY);
+	Frame band = frameView(&frm, rect(0, screenY/3, screenX, 2*screenY/3), NULL); // lines cross its edges
+
+	flushFrame(&frm, rgb(0,0,0));
+	long long checkedNs = timeLines(&band, count, plotLineChecked);
+	unsigned long checkedSum = frameChecksum(&frm);
+
+	flushFrame(&frm, rgb(0,0,0));
+	long long clippedNs = timeLines(&band, count, plotLine);
+	unsigned long clippedSum = frameChecksum(&frm);
+
+	printf("lines, %d up to 60px long, clipped to a %dx%d band\n", count, screenX, screenY/3);
+	printf("  checked: %8.2f M lines/s\n", count * 1000.0 / checkedNs);
+	printf("  clipped: %8.2f M lines/s  (%.1fx)\n", count * 1000.0 / clippedNs, (double)checkedNs / clippedNs);
+	printf("  output %s\n", checkedSum == clippedSum ? "identical" : "DIFFERS");
+
+	freeFrame(&frm);
+	return checkedSum == clippedSum ? 0 : 1;
+}
+
+// --bench-projectiles [n]: n bullets and bombs updated and drawn every frame
+int benchProjectiles(int count) {
+	const int frames = 100;
+	Game game;
+	initGame(&game);
+	initSpriteCache();
+	ProjectilePool pool;
+	initProjectilePool(&pool, count);
+	Frame canvas = newFrame(game.canvasWidth, game.canvasHeight);
+	Rect area = rect(-projectileMargin, -projectileMargin, game.canvasWidth + projectileMargin, game.canvasHeight + projectileMargin);
+	CollisionGrid* grid = new CollisionGrid;
+	unsigned int seed = 12345;
+	long long updateNs = 0;
+	long long drawNs = 0;
+	int hits = 0;
+	int i, f;
+
+	for (f = 0; f < frames; f++) {
+		// top up whatever left the canvas, so every frame moves count projectiles
+		while (pool.count < count) {
+			seed = seed * 1103515245u + 12345u;
+			int kind = (seed >> 16) & 1;
+			int x = (seed >> 8) % game.canvasWidth;
+			seed = seed * 1103515245u + 12345u;
+			int y = (seed >> 8) % game.canvasHeight;
+			int vx = (int)((seed >> 4) % 5) - 2;
+			spawnProjectile(&pool, kind, coord(x, y), vx, kind == projectileBomb ? game.bombVelocity : -game.ammunitionVelocity);
+		}
+
+		long long start = nowNs();
+		updateProjectiles(&pool, area);
+		initCollisionGrid(grid, area, collisionCellSize);
+		addCollider(grid, rect(400, 35, 575, 65), -1, layerPlane, layerBullet);
+		for (i = 0; i < pool.count; i++) {
+			if (pool.alive[i]) addCollider(grid, rect(pool.x[i], pool.y[i], pool.x[i] + 1, pool.y[i] + 1), i, pool.kind[i] == projectileBomb ? layerBomb : layerBullet, 0);
+		}
+		hits = findCollisions(grid);
+		compactProjectiles(&pool);
+		updateNs += nowNs() - start;
+
+		flushFrame(&canvas, rgb(0,0,0));
+		start = nowNs();
+		drawProjectiles(&canvas, &pool, projectileBomb, game.ammunitionLength);
+		drawProjectiles(&canvas, &pool, projectileBullet, game.ammunitionLength);
+		drawNs += nowNs() - start;
+	}
+
+	printf("projectiles, %d per frame, %d frames on a %dx%d canvas\n", count, frames, game.canvasWidth, game.canvasHeight);
+	printf("  update + collide: %8.2f ms/frame  (%6.1f ns/projectile)\n", updateNs / 1e6 / frames, (double)updateNs / frames / count);
+	printf("  draw:             %8.2f ms/frame  (%6.1f ns/projectile)\n", drawNs / 1e6 / frames, (double)drawNs / frames / count);
+	printf("  (%d still alive, %d hits on the last frame)\n", pool.count, hits);
+
+	delete grid;
+	freeFrame(&canvas);
+	freeProjectilePool(&pool);
+	freeGame(&game);
+	return 0;
+}
+
+// --bench-collisions: broad + narrow phase cost from 10k to 100k entities
+int benchCollisions(int runs) {
+	const int counts[] = {10000, 20000, 50000, 100000};
+	CollisionGrid* grid = new CollisionGrid;
+
+	printf("collisions, %d runs each (ns/entity should stay flat)\n", runs);
+	printf("  %8s  %26s  %26s\n", "entities", "projectiles vs 2 targets", "4x4 boxes, all vs all");
+	for (int k = 0; k < countOf(counts); k++) {
+		int n = counts[k];
+		long long targetsNs = 0;
+		long long allNs = 0;
+		int targetPairs = 0;
+		int allPairs = 0;
+
+		for (int run = 0; run < runs; run++) {
+			// game-like: points on the canvas, only the plane and ship look for hits
+			unsigned int seed = 12345 + run;
+			long long start = nowNs();
+			initCollisionGrid(grid, rect(0, 0, 1000, 500), collisionCellSize);
+			addCollider(grid, rect(400, 35, 575, 65), -1, layerPlane, layerBullet);
+			addCollider(grid, rect(450, 390, 549, 520), -1, layerShip, layerBomb);
+			for (int i = 0; i < n; i++) {
+				seed = seed * 1103515245u + 12345u;
+				int x = (seed >> 8) % 1000;
+				seed = seed * 1103515245u + 12345u;
+				int y = (seed >> 8) % 500;
+				addCollider(grid, rect(x, y, x + 1, y + 1), i, (seed >> 4) & 1 ? layerBomb : layerBullet, 0);
+			}
+			targetPairs = findCollisions(grid);
+			targetsNs += nowNs() - start;
+
+			// every box hits every other; the area grows with n so the density stays that of 10k on the canvas
+			int side = (int)(1000 * sqrt(n / 10000.0));
+			start = nowNs();
+			initCollisionGrid(grid, rect(0, 0, side, side / 2), collisionCellSize);
+			for (int i = 0; i < n; i++) {
+				seed = seed * 1103515245u + 12345u;
+				int x = (seed >> 8) % side;
+				seed = seed * 1103515245u + 12345u;
+				int y = (seed >> 8) % (side / 2);
+				addCollider(grid, rect(x, y, x + 4, y + 4), i, 1, 1);
+			}
+			allPairs = findCollisions(grid);
+			allNs += nowNs() - start;
+		}
+		printf("  %8d  %8.2f ms %5.1f ns %5d  %8.2f ms %5.1f ns %5d pairs\n", n,
+			targetsNs / 1e6 / runs, (double)targetsNs / runs / n, targetPairs,
+			allNs / 1e6 / runs, (double)allNs / runs / n, allPairs);
+	}
+
+	delete grid;
+	return 0;
+}
+
+// --bench-input [n]: n packets through a FIFO stand-in mouse, write to main loop pickup
+int benchInput(int packets) {
+	if (packets < 1) {
+		printf("Error: --bench-input needs at least one packet.\n");
+		return 6;
+	}
+	char path[64];
+	snprintf(path, sizeof(path), "/tmp/shooter-mice-%d", (int)getpid());
+	if (mkfifo(path, 0600)) {
+		printf("Error: cannot create FIFO %s.\n", path);
+		return 1;
+	}
+	MouseInput* in = new MouseInput;
+	if (!startMouseInput(in, path)) {
+		printf("Error: cannot open FIFO %s.\n", path);
+		unlink(path);
+		delete in;
+		return 1;
+	}
+	int writer = open(path, O_WRONLY);
+	if (writer < 0) {
+		printf("Error: cannot write FIFO %s.\n", path);
+		stopMouseInput(in);
+		delete in;
+		unlink(path);
+		return 1;
+	}
+
+	vector<long long> latencyNs; // per packet sent
+	MouseState m;
+	m.cursor = coord(0, 0);
+	for (int i = 0; i < packets; i++) {
+		unsigned char pkt[3] = {(unsigned char)(0x08 | (i & 1)), 1, 0}; // one pixel right, left button toggling
+		long long start = nowNs();
+		if (write(writer, pkt, 3) != 3) break;
+		while (!pollMouseInput(in, &m)) this_thread::yield();
+		latencyNs.push_back(nowNs() - start);
+	}
+	int sent = latencyNs.size();
+	sort(latencyNs.begin(), latencyNs.end());
+
+	if (sent) {
+		printf("mouse input through a FIFO, %d packets\n", sent);
+		printf("  write to pickup median %8.1f us\n", latencyNs[sent / 2] / 1000.0);
+		printf("  write to pickup p99    %8.1f us\n", latencyNs[(sent - 1) * 99 / 100] / 1000.0);
+		printf("  cursor ended at %d,%d (expected %d,%d)\n", m.cursor.x, m.cursor.y,
+			min(screenX/2 + sent, screenX - 1), screenY/2);
+	} else {
+		printf("Error: cannot write to FIFO %s.\n", path);
+	}
+
+	close(writer);
+	stopMouseInput(in);
+	delete in;
+	unlink(path);
+	return sent == packets ? 0 : 1;
+}
+
+// --bench-surfaces [iterations]: full-screen clear and present cost per surface backing
+int benchSurfaces(int iterations) {
+	FrameBuffer fb;
+	fb.lineLen = screenX * 4;
+	fb.smemLen = fb.lineLen * screenY;
+	fb.bpp = 32;
+	fb.ptr = (char*)calloc(fb.smemLen, 1);
+
+	printf("surfaces, %dx%d, %d iterations\n", screenX, screenY, iterations);
+	printf("  %-9s %-9s %8s %12s %12s\n", "asked", "got", "stride", "clear", "present");
+	for (int b = 0; b < surfaceBackings; b++) {
+		// malloc is the old layout: tightly packed rows, no alignment
+		Frame frm = newFrame(screenX, screenY, b == surfaceMalloc ? screenX : 0, b);
+		flushFrame(&frm, rgb(0,0,0)); // fault the pages in before timing
+
+		long long start = nowNs();
+		for (int i = 0; i < iterations; i++) flushFrame(&frm, rgb(i & 0xFF, 33, 33));
+		long long clearNs = nowNs() - start;
+
+		start = nowNs();
+		for (int i = 0; i < iterations; i++) showFrame<FormatXRGB8888>(&frm, &fb);
+		long long presentNs = nowNs() - start;
+
+		printf("  %-9s %-9s %8d %9.1f us %9.1f us\n", surfaceBackingNames[b], surfaceBackingNames[frm.backing], frm.stride,
+			clearNs / 1000.0 / iterations, presentNs / 1000.0 / iterations);
+		freeFrame(&frm);
+	}
+	printSurfaceStats("  ");
+
+	free(fb.ptr);
+	return 0;
+}
+
+// --bench-kernels [iterations]: throughput of every clear/present kernel variant
+int benchKernels(int iterations) {
+	Frame src = newFrame(screenX, screenY);
+	Frame dst = newFrame(screenX, screenY);
+	double frameBytes = (double)screenX * screenY * sizeof(uint32_t);
+	int i, k, y;
+	int status = 0;
+
+	// a translucent layer for the blend: premultiplied, alpha varying along the row
+	Frame layer = newFrame(screenX, screenY);
+	for (y = 0; y < screenY; y++) {
+		for (int x = 0; x < screenX; x++) {
+			uint32_t a = (x * 7 + y) & 0xFF;
+			frameRow(&layer, y)[x] = a << 24 | mulDiv255(a, 200) << 16 | mulDiv255(a, (x ^ y) & 0xFF) << 8 | mulDiv255(a, 99);
+		}
+	}
+	unsigned long blendSum = 0;
+
+	// an indexed frame using the whole of a made-up palette for the expand
+	Frame indexed = newIndexedFrame(screenX, screenY);
+	uint32_t colors[256];
+	for (i = 0; i < 256; i++) colors[i] = 0xFF000000u | i * 0x010305u;
+	for (y = 0; y < screenY; y++) {
+		for (int x = 0; x < screenX; x++) indexRow(&indexed, y)[x] = x * 31 + y;
+	}
+	unsigned long expandSum = 0;
+
+	flushFrame(&src, rgb(33,33,33));
+	flushFrame(&dst, rgb(0,0,0)); // fault the pages in, so the first variant timed doesn't pay for it
+	printf("pixel kernels, %dx%d, %d iterations (GB/s of bytes read + written)\n", screenX, screenY, iterations);
+	printf("  %-8s %10s %10s %10s %10s %10s\n", "variant", "clear", "copy", "convert", "blend", "expand");
+	for (k = 0; k < kernelVariantCount; k++) {
+		const PixelKernels* v = &kernelVariants[k];
+		if (!isKernelSupported(v)) {
+			printf("  %-8s not supported on this CPU\n", v->name);
+			continue;
+		}
+		long long start = nowNs();
+		for (i = 0; i < iterations; i++) {
+			for (y = 0; y < screenY; y++) v->fillRow(frameRow(&dst, y), 0xFF212121u + i, screenX);
+		}
+		double clearGBs = frameBytes * iterations / (nowNs() - start);
+
+		start = nowNs();
+		for (i = 0; i < iterations; i++) {
+			for (y = 0; y < screenY; y++) v->copyRow(frameRow(&dst, y), frameRow(&src, y), screenX);
+		}
+		double copyGBs = 2 * frameBytes * iterations / (nowNs() - start);
+
+		start = nowNs();
+		for (i = 0; i < iterations; i++) {
+			for (y = 0; y < screenY; y++) v->convertRow(frameRow(&dst, y), frameRow(&src, y), screenX);
+		}
+		double convertGBs = 2 * frameBytes * iterations / (nowNs() - start);
+
+		// blend reads both and writes dst; every variant must land on the same pixels
+		flushFrame(&dst, rgb(33,33,33));
+		start = nowNs();
+		for (i = 0; i < iterations; i++) {
+			for (y = 0; y < screenY; y++) v->blendRow(frameRow(&dst, y), frameRow(&layer, y), screenX);
+		}
+		double blendGBs = 3 * frameBytes * iterations / (nowNs() - start);
+		unsigned long sum = frameChecksum(&dst);
+		int same = !blendSum || sum == blendSum;
+		blendSum = sum;
+
+		// expand reads a byte and writes four per pixel
+		start = nowNs();
+		for (i = 0; i < iterations; i++) {
+			for (y = 0; y < screenY; y++) v->expandRow(frameRow(&dst, y), indexRow(&indexed, y), screenX, colors);
+		}
+		double expandGBs = 1.25 * frameBytes * iterations / (nowNs() - start);
+		sum = frameChecksum(&dst);
+		int sameExpand = !expandSum || sum == expandSum;
+		expandSum = sum;
+
+		printf("  %-8s %10.2f %10.2f %10.2f %10.2f %10.2f%s%s%s\n", v->name, clearGBs, copyGBs, convertGBs, blendGBs, expandGBs,
+			strcmp(v->name, kernels.name) == 0 ? "  (selected)" : "", same ? "" : "  BLEND DIFFERS", sameExpand ? "" : "  EXPAND DIFFERS");
+		if (!same || !sameExpand) status = 1;
+	}
+
+	freeFrame(&indexed);
+	freeFrame(&layer);
+	freeFrame(&src);
+	freeFrame(&dst);
+	return status;
+}
+
+// the same pseudo-random mix of recordable primitives, drawn on frm or recorded into buf
+void drawCommandScene(Frame* frm, CommandBuffer* buf, int count) {
+	static const Outline* outlines[] = {&shipOutline, &planeOutline, &fishBodyOutline};
+	const Sprite* shapes[] = {&sprites.ship, &sprites.plane, &sprites.bomb, &sprites.peluru};
+	vector<Coord> polygon(3);
+	unsigned int seed = 12345;
+	for (int i = 0; i < count; i++) {
+		seed = seed * 1103515245u + 12345u;
+		int x = (seed >> 8) % (screenX + 100) - 50;
+		seed = seed * 1103515245u + 12345u;
+		int y = (seed >> 8) % (screenY + 100) - 50;
+		seed = seed * 1103515245u + 12345u;
+		int size = (seed >> 8) % 61;
+		RGB color = rgb(i & 0xFF, 99, size * 4);
+		switch (i % 6) {
+			case 0:
+				if (buf) recordLine(buf, x, y, x + size - 30, y + 30 - size / 2, color);
+				else plotLine(frm, x, y, x + size - 30, y + 30 - size / 2, color);
+				break;
+			case 1:
+				if (buf) recordCircle(buf, x, y, size / 2, color);
+				else plotCircle(frm, x, y, size / 2, color);
+				break;
+			case 2:
+				polygon[0] = coord(x, y);
+				polygon[1] = coord(x + size, y + size / 3);
+				polygon[2] = coord(x + size / 4, y + 60 - size);
+				if (buf) recordPolygon(buf, polygon, color);
+				else fillPolygon(frm, polygon, color);
+				break;
+			case 3:
+				if (buf) recordOutline(buf, outlines[size % 3], coord(x, y), color);
+				else fillOutline(frm, outlines[size % 3], coord(x, y), color);
+				break;
+			case 4:
+				if (buf) recordRect(buf, rect(x - 2, y, x + 3, y + size), color);
+				else {
+					markDirty(frm, x - 2, y, x + 2, y + size - 1);
+					fillRect(frm, rectIntersect(rect(x - 2, y, x + 3, y + size), frm->clip), packRGB(color));
+				}
+				break;
+			case 5:
+				if (buf) recordSprite(buf, shapes[size % 4], coord(x, y));
+				else blitSprite(frm, shapes[size % 4], coord(x, y));
+				break;
+		}
+	}
+}
+
+// --bench-commands [n]: a scene of n primitives drawn immediately vs recorded and run tile by tile
+int benchCommands(int count) {
+	const int runs = 5;
+	initSpriteCache();
+	Frame frm = newFrame(screenX, screenY);
+	Damage damage[3];
+	unsigned long sum[3];
+	long long best[3] = {0, 0, 0};
+	long long recordNs = 0;
+	CommandBuffer* buf = new CommandBuffer;
+	WorkerPool pool;
+	startWorkerPool(&pool, thread::hardware_concurrency());
+
+	for (int mode = 0; mode < 3; mode++) {
+		for (int run = 0; run < runs; run++) {
+			initDamage(&damage[mode]);
+			frm.damage = &damage[mode];
+			fillRect(&frm, frm.clip, 0);
+			long long start = nowNs();
+			if (mode == 0) {
+				drawCommandScene(&frm, NULL, count);
+			} else {
+				beginCommands(buf, &frm);
+				drawCommandScene(&frm, buf, count);
+				if (mode == 1 && (!run || nowNs() - start < recordNs)) recordNs = nowNs() - start;
+				executeCommands(buf, mode == 2 ? &pool : NULL);
+			}
+			long long spent = nowNs() - start;
+			if (!run || spent < best[mode]) best[mode] = spent;
+		}
+		sum[mode] = frameChecksum(&frm);
+	}
+	int same = sum[1] == sum[0] && sum[2] == sum[0];
+	for (int mode = 1; mode < 3; mode++) {
+		same = same && damage[mode].curCount == damage[0].curCount && !memcmp(damage[mode].cur, damage[0].cur, sizeof(damage[0].cur));
+	}
+
+	printf("command buffer, %d primitives (lines, circles, polygons, outlines, spans, sprites) on %dx%d, %dx%d tiles\n",
+		count, screenX, screenY, commandTileWidth, commandTileHeight);
+	printf("  immediate:          %8.2f ms\n", best[0] / 1e6);
+	printf("  tiled, 1 thread:    %8.2f ms  (%.2fx, recording %.2f ms)\n", best[1] / 1e6, (double)best[0] / best[1], recordNs / 1e6);
+	printf("  tiled, %2d thread(s): %7.2f ms  (%.2fx)\n", pool.count, best[2] / 1e6, (double)best[0] / best[2]);
+	printf("  output and damage %s\n", same ? "identical" : "DIFFER");
+
+	stopWorkerPool(&pool);
+	delete buf;
+	freeFrame(&frm);
+	return same ? 0 : 1;
+}
+
+/* Primitive microbenchmarks: each primitive over a seeded random workload
+ * at three sizes, timed best of N runs, in ns per unit of work (a pixel
+ * written, or a scanline for intersectionGenerator). Results can be saved
+ * as JSON and compared against such a file later.
+ */
+typedef struct s_microItem {
+	int a, b, c, d; // line x0,y0,x1,y1; circle and flood center a,b and radius c
+	Rect box;       // every pixel the item can touch
+} MicroItem;
+
+typedef struct s_microWorkload {
+	int size;
+	Frame frm;
+	FrameBuffer fb;
+	vector<MicroItem> items;
+	vector<vector<Coord> > polygons;
+} MicroWorkload;
+
+typedef struct s_microBench {
+	const char* name;
+	const char* unit;
+	int sizes[3];
+	long long (*setup)(MicroWorkload* w, int size); // build the workload, return units of work per run
+	void (*prepare)(MicroWorkload* w);              // untimed, before every run; may be NULL
+	void (*run)(MicroWorkload* w);
+} MicroBench;
+
+typedef struct s_microResult {
+	char name[32];
+	char size[16];
+	const char* unit;
+	long long units;
+	long long ns;
+} MicroResult;
+
+unsigned int microSeed;
+
+int microRandom(int n) {
+	microSeed = microSeed * 1103515245u + 12345u;
+	return (microSeed >> 8) % n;
+}
+
+long long countCovered(Frame* frm, Rect box) {
+	long long count = 0;
+	for (int y = box.y0; y < box.y1; y++) {
+		uint32_t* row = frameRow(frm, y);
+		for (int x = box.x0; x < box.x1; x++) count += row[x] != 0;
+	}
+	return count;
+}
+
+// pixels draw writes for one item on a cleared box (after prepare, if any)
+long long countDrawn(Frame* frm, const MicroItem* item, void (*prepare)(Frame*, const MicroItem*), void (*draw)(Frame*, const MicroItem*)) {
+	Rect box = rectIntersect(item->box, frm->clip);
+	fillRect(frm, box, 0);
+	if (prepare) prepare(frm, item);
+	long long before = countCovered(frm, box);
+	draw(frm, item);
+	return countCovered(frm, box) - before;
+}
+
+void drawMicroLine(Frame* frm, const MicroItem* item) {
+	plotLine(frm, item->a, item->b, item->c, item->d, rgb(200, 99, 99));
+}
+
+void drawMicroLineWidth(Frame* frm, const MicroItem* item) {
+	plotLineWidth(frm, item->a, item->b, item->c, item->d, 3, rgb(200, 99, 99));
+}
+
+void drawMicroCircle(Frame* frm, const MicroItem* item) {
+	plotCircle(frm, item->a, item->b, item->c, rgb(200, 99, 99));
+}
+
+void drawMicroFlood(Frame* frm, const MicroItem* item) {
+	colorFlood(frm, item->a, item->b, rgb(200, 99, 99));
+}
+
+// a regular 12-gon c across, centered on (a,b)
+const vector<Coord>& microPolygon(const MicroItem* item) {
+	static thread_local vector<Coord> polygon(12);
+	for (int k = 0; k < 12; k++) {
+		double angle = k * 2 * M_PI / 12;
+		polygon[k] = coord(item->a + (int)(item->c / 2 * cos(angle)), item->b + (int)(item->c / 2 * sin(angle)));
 	}
-	
-	sort(a.begin(), a.end(), compareByAxis);
-	
-	return a;
+	return polygon;
 }
 
-int isColorEqual(RGB color1, RGB color2){
-if (color1.r == color2.r && color1.g == color2.g && color1.b == color2.b){return 1;}
-else {return 0;}
+void drawMicroFill(Frame* frm, const MicroItem* item) {
+	fillPolygon(frm, microPolygon(item), rgb(200, 99, 99));
+}
+
+void drawMicroPatternFill(Frame* frm, const MicroItem* item) {
+	fillPolygonPattern(frm, microPolygon(item), &sprites.fishPattern);
+}
+
+// the same 12-gon, its vertices off the pixel grid
+void drawMicroAAFill(Frame* frm, const MicroItem* item) {
+	static thread_local vector<Point> polygon(12);
+	for (int k = 0; k < 12; k++) {
+		double angle = k * 2 * M_PI / 12;
+		polygon[k] = point(item->a + 0.3f + item->c / 2 * cos(angle), item->b + 0.6f + item->c / 2 * sin(angle));
 	}
+	fillPolygonAA(frm, polygon, rgb(200, 99, 99), fillNonZero);
+}
 
+void runMicroItems(MicroWorkload* w, void (*draw)(Frame*, const MicroItem*)) {
+	for (size_t i = 0; i < w->items.size(); i++) draw(&w->frm, &w->items[i]);
+}
 
-void colorFlood(Frame* frm,int x, int y,RGB color){	
-	if (isColorEqual(frm->px[x][y],color)==1){
-		//do nothing
-		} 
-	else{
-		insertPixel(frm,coord(x,y),color);
-		colorFlood(frm,x+1,y,color);
-		colorFlood(frm,x,y+1,color);
-		colorFlood(frm,x-1,y,color);
-		colorFlood(frm,x,y-1,color);
-	}	
+// lines size long (on the longer axis) in any direction, inside the frame
+long long setupMicroLines(MicroWorkload* w, int size, void (*draw)(Frame*, const MicroItem*)) {
+	w->frm = newFrame(max(1366, 2 * size + 16), max(768, 2 * size + 16));
+	int count = max(16, (1 << 20) / size);
+	long long units = 0;
+	for (int i = 0; i < count; i++) {
+		MicroItem item;
+		int along = microRandom(2 * size + 1) - size;
+		int across = microRandom(2) ? size : -size;
+		item.a = 4 + size + microRandom(w->frm.width - 8 - 2 * size);
+		item.b = 4 + size + microRandom(w->frm.height - 8 - 2 * size);
+		item.c = item.a + (i % 2 ? along : across);
+		item.d = item.b + (i % 2 ? across : along);
+		item.box = rect(min(item.a, item.c) - 4, min(item.b, item.d) - 4, max(item.a, item.c) + 5, max(item.b, item.d) + 5);
+		w->items.push_back(item);
+		units += countDrawn(&w->frm, &item, NULL, draw);
+	}
+	return units;
 }
 
-/* Function to draw ship */
-void drawShip(Frame *frame, Coord center, RGB color)
-{
-	// Ship's attributes
-	int panjangDekBawah = 100;
-	int deltaDekAtasBawah = 60;
-	int height = 40;
-	int jarakKeUjung = panjangDekBawah / 2 + deltaDekAtasBawah / 2;
-	
-	// Ship's relative coordinate to canvas, ship's actuator
-	int xShipCoordinate = center.x - jarakKeUjung;
-	int yShipCoordinate = center.y - height;
-	
-	// Ship's border coordinates
-	vector<Coord>  shipCoordinates;
-	
-	shipCoordinates.push_back(coord(0, 0));
-	shipCoordinates.push_back(coord(0 + jarakKeUjung + jarakKeUjung, 0));
-	shipCoordinates.push_back(coord(panjangDekBawah / 2 + panjangDekBawah / 2 + deltaDekAtasBawah/2, height));
-	shipCoordinates.push_back(coord(deltaDekAtasBawah/2, height));
-		
-	// Draw ship's border relative to canvas
-	for(int i = 0; i < shipCoordinates.size(); i++){
-		int x0, y0, x1, y1;
-		
-		if(i < shipCoordinates.size() - 1){
-			x0 = shipCoordinates.at(i).x + xShipCoordinate;
-			y0 = shipCoordinates.at(i).y + yShipCoordinate;
-			x1 = shipCoordinates.at(i + 1).x + xShipCoordinate;
-			y1 = shipCoordinates.at(i + 1).y + yShipCoordinate;
-		}else{
-			x0 = shipCoordinates.at(shipCoordinates.size() - 1).x + xShipCoordinate;
-			y0 = shipCoordinates.at(shipCoordinates.size() - 1).y + yShipCoordinate;
-			x1 = shipCoordinates.at(0).x + xShipCoordinate;
-			y1 = shipCoordinates.at(0).y + yShipCoordinate;
+long long setupMicroPlotLine(MicroWorkload* w, int size) {
+	return setupMicroLines(w, size, drawMicroLine);
+}
+
+void runMicroPlotLine(MicroWorkload* w) {
+	runMicroItems(w, drawMicroLine);
+}
+
+long long setupMicroPlotLineWidth(MicroWorkload* w, int size) {
+	return setupMicroLines(w, size, drawMicroLineWidth);
+}
+
+void runMicroPlotLineWidth(MicroWorkload* w) {
+	runMicroItems(w, drawMicroLineWidth);
+}
+
+// circles size across
+long long setupMicroPlotCircle(MicroWorkload* w, int size) {
+	w->frm = newFrame(1366, 768);
+	int r = size / 2;
+	int count = max(16, (1 << 19) / size);
+	long long units = 0;
+	for (int i = 0; i < count; i++) {
+		MicroItem item;
+		item.a = r + microRandom(1366 - 2 * r);
+		item.b = r + microRandom(768 - 2 * r);
+		item.c = r;
+		item.box = rect(item.a - r, item.b - r, item.a + r + 1, item.b + r + 1);
+		w->items.push_back(item);
+		units += countDrawn(&w->frm, &item, NULL, drawMicroCircle);
+	}
+	return units;
+}
+
+void runMicroPlotCircle(MicroWorkload* w) {
+	runMicroItems(w, drawMicroCircle);
+}
+
+// 12-gons size across, filled solid, with the fish pattern or anti-aliased; same items for all
+long long setupMicroFills(MicroWorkload* w, int size, void (*draw)(Frame*, const MicroItem*)) {
+	initSpriteCache();
+	w->frm = newFrame(1366, 768);
+	int count = max(16, (1 << 22) / (size * size));
+	long long units = 0;
+	for (int i = 0; i < count; i++) {
+		MicroItem item;
+		item.a = size / 2 + 1 + microRandom(1366 - size - 2);
+		item.b = size / 2 + 1 + microRandom(768 - size - 2);
+		item.c = size;
+		item.box = rect(item.a - size / 2 - 1, item.b - size / 2 - 1, item.a + size / 2 + 2, item.b + size / 2 + 2);
+		w->items.push_back(item);
+		units += countDrawn(&w->frm, &item, NULL, draw);
+	}
+	return units;
+}
+
+long long setupMicroFillPolygon(MicroWorkload* w, int size) {
+	return setupMicroFills(w, size, drawMicroFill);
+}
+
+void runMicroFillPolygon(MicroWorkload* w) {
+	runMicroItems(w, drawMicroFill);
+}
+
+long long setupMicroFillPattern(MicroWorkload* w, int size) {
+	return setupMicroFills(w, size, drawMicroPatternFill);
+}
+
+void runMicroFillPattern(MicroWorkload* w) {
+	runMicroItems(w, drawMicroPatternFill);
+}
+
+long long setupMicroFillAA(MicroWorkload* w, int size) {
+	return setupMicroFills(w, size, drawMicroAAFill);
+}
+
+void runMicroFillAA(MicroWorkload* w) {
+	runMicroItems(w, drawMicroAAFill);
+}
+
+// circles size across on a grid, so they never touch, each flooded from its center
+long long setupMicroColorFlood(MicroWorkload* w, int size) {
+	int cell = size + 4;
+	int columns = max(2, 2048 / cell);
+	int rows = max(2, (1 << 22) / (cell * cell * columns));
+	int r = size / 2;
+	w->frm = newFrame(columns * cell, rows * cell);
+	long long units = 0;
+	for (int i = 0; i < columns * rows; i++) {
+		MicroItem item;
+		item.a = (i % columns) * cell + r + 1 + microRandom(2);
+		item.b = (i / columns) * cell + r + 1 + microRandom(2);
+		item.c = r;
+		item.box = rect(item.a - r, item.b - r, item.a + r + 1, item.b + r + 1);
+		w->items.push_back(item);
+		units += countDrawn(&w->frm, &item, drawMicroCircle, drawMicroFlood);
+	}
+	return units;
+}
+
+// empty the circles again
+void prepareMicroColorFlood(MicroWorkload* w) {
+	fillRect(&w->frm, w->frm.clip, 0);
+	runMicroItems(w, drawMicroCircle);
+}
+
+void runMicroColorFlood(MicroWorkload* w) {
+	runMicroItems(w, drawMicroFlood);
+}
+
+// star-ish polygons of 12 vertices, size across; one unit per scanline
+long long setupMicroIntersections(MicroWorkload* w, int size) {
+	int count = max(16, (1 << 17) / size);
+	long long units = 0;
+	for (int i = 0; i < count; i++) {
+		vector<Coord> polygon;
+		for (int k = 0; k < 12; k++) {
+			double angle = k * 2 * M_PI / 12;
+			int radius = size / 2 - microRandom(size / 4 + 1);
+			polygon.push_back(coord(size / 2 + (int)(radius * cos(angle)), size / 2 + (int)(radius * sin(angle))));
 		}
-		
-		plotLine(frame, x0, y0, x1, y1, color);
+		w->polygons.push_back(polygon);
+		units += size;
 	}
-	
-	// Dummy pattern's coordinate
-	
-	vector<Coord> patternCoordinates = getFishCoordinate(coord(50,20));
-	
+	return units;
 }
 
+void runMicroIntersections(MicroWorkload* w) {
+	volatile size_t found = 0;
+	for (size_t i = 0; i < w->polygons.size(); i++) {
+		for (int y = 0; y < w->size; y++) found += intersectionGenerator(y, w->polygons[i]).size();
+	}
+}
 
-void drawAmmunition(Frame *frame, Coord upperBoundPosition, int ammunitionWidth, int ammunitionLength, RGB color){
-	plotLine(frame, upperBoundPosition.x, upperBoundPosition.y, upperBoundPosition.x, upperBoundPosition.y + ammunitionLength, color);
-	
-	int i;
-	for(i = 0; i < ammunitionWidth; i++){
-		plotLine(frame, upperBoundPosition.x + i, upperBoundPosition.y, upperBoundPosition.x + i, upperBoundPosition.y + ammunitionLength, color);
-		plotLine(frame, upperBoundPosition.x - i, upperBoundPosition.y, upperBoundPosition.x - i, upperBoundPosition.y + ammunitionLength, color);
-	}	
+// a whole frame 16:9, size wide; clear and present touch every pixel
+long long setupMicroFrame(MicroWorkload* w, int size) {
+	w->frm = newFrame(size, size * 9 / 16);
+	w->fb.bpp = 32;
+	w->fb.lineLen = w->frm.width * 4;
+	w->fb.smemLen = w->fb.lineLen * w->frm.height;
+	w->fb.ptr = (char*)calloc(w->fb.smemLen, 1);
+	flushFrame(&w->frm, rgb(0,0,0)); // fault the pages in
+	int repeat = max(1, (1 << 23) / (w->frm.width * w->frm.height));
+	w->items.resize(repeat);
+	return (long long)repeat * w->frm.width * w->frm.height;
 }
 
-void drawPeluru(Frame *frame, Coord center, RGB color)
-{
-	int panjangPeluru = 10;
-	//DrawKiri
-	plotLine(frame, center.x - 3, center.y + panjangPeluru / 2, center.x -3, center.y - panjangPeluru / 2, color); 
-	
-	//DrawKanan
-	plotLine(frame, center.x + 3, center.y + panjangPeluru / 2, center.x + 3, center.y - panjangPeluru / 2, color);
-	
-	//DrawBawah
-	plotLine(frame, center.x - 3, center.y + panjangPeluru / 2, center.x +3, center.y + panjangPeluru / 2, color);
-	
-	//DrawUjungKiri
-	plotLine(frame, center.x - 3, center.y - panjangPeluru / 2, center.x, center.y - (panjangPeluru / 2 + 4), color);
-	
-	//DrawUjungKanan
-	plotLine(frame, center.x + 3, center.y - panjangPeluru / 2, center.x, center.y - (panjangPeluru / 2 + 4), color);
+void runMicroFlushFrame(MicroWorkload* w) {
+	for (size_t i = 0; i < w->items.size(); i++) flushFrame(&w->frm, rgb(i & 0xFF, 33, 33));
 }
 
-void drawPlane(Frame *frame, Coord position, RGB color) {
+void runMicroShowFrame(MicroWorkload* w) {
+	for (size_t i = 0; i < w->items.size(); i++) showFrame<FormatXRGB8888>(&w->frm, &w->fb);
+}
 
-	// Ship's relative coordinate to canvas, ship's actuator
-	int xPlaneCoordinate = position.x;
-	int yPlaneCoordinate = position.y;
-	
-	// Ship's border coordinates
-	vector<Coord>  planeCoordinates;
-	planeCoordinates.push_back(coord(0,0));
-	planeCoordinates.push_back(coord(planeCoordinates.at(0).x + 15, planeCoordinates.at(0).y-5));
-	planeCoordinates.push_back(coord(planeCoordinates.at(1).x + 30, planeCoordinates.at(1).y-3));
-	planeCoordinates.push_back(coord(planeCoordinates.at(2).x + 13, planeCoordinates.at(2).y-4));
-	planeCoordinates.push_back(coord(planeCoordinates.at(3).x + 13, planeCoordinates.at(3).y-3));
-	planeCoordinates.push_back(coord(planeCoordinates.at(4).x + 13, planeCoordinates.at(4).y+3));
-	planeCoordinates.push_back(coord(planeCoordinates.at(5).x + 13, planeCoordinates.at(5).y+4));
-	planeCoordinates.push_back(coord(planeCoordinates.at(6).x + 50, planeCoordinates.at(6).y-3));
-	planeCoordinates.push_back(coord(planeCoordinates.at(7).x + 5, planeCoordinates.at(7).y-18));
-	planeCoordinates.push_back(coord(planeCoordinates.at(8).x + 10, planeCoordinates.at(8).y-4));
-	planeCoordinates.push_back(coord(planeCoordinates.at(9).x + 3, planeCoordinates.at(9).y+27));
-	planeCoordinates.push_back(coord(planeCoordinates.at(10).x - 1, planeCoordinates.at(10).y+5));
-	planeCoordinates.push_back(coord(planeCoordinates.at(11).x + 1, planeCoordinates.at(11).y+5));
-	planeCoordinates.push_back(coord(planeCoordinates.at(12).x - 67, planeCoordinates.at(12).y+3));
-	planeCoordinates.push_back(coord(planeCoordinates.at(13).x + 13, planeCoordinates.at(13).y+25));
-	planeCoordinates.push_back(coord(planeCoordinates.at(14).x - 10, planeCoordinates.at(14).y-6));
-	planeCoordinates.push_back(coord(planeCoordinates.at(15).x - 17, planeCoordinates.at(15).y-18));
-	planeCoordinates.push_back(coord(planeCoordinates.at(16).x - 37, planeCoordinates.at(16).y-1));
-	planeCoordinates.push_back(coord(planeCoordinates.at(17).x - 27, planeCoordinates.at(17).y-3));
-	
-
-	// Draw ship's border relative to canvas
-	for(int i = 0; i < planeCoordinates.size(); i++){
-		int x0, y0, x1, y1;
-		
-		if(i < planeCoordinates.size() - 1){
-			x0 = planeCoordinates.at(i).x + xPlaneCoordinate;
-			y0 = planeCoordinates.at(i).y + yPlaneCoordinate;
-			x1 = planeCoordinates.at(i + 1).x + xPlaneCoordinate;
-			y1 = planeCoordinates.at(i + 1).y + yPlaneCoordinate;
-		}else{
-			x0 = planeCoordinates.at(planeCoordinates.size() - 1).x + xPlaneCoordinate;
-			y0 = planeCoordinates.at(planeCoordinates.size() - 1).y + yPlaneCoordinate;
-			x1 = planeCoordinates.at(0).x + xPlaneCoordinate;
-			y1 = planeCoordinates.at(0).y + yPlaneCoordinate;
+const MicroBench microBenches[] = {
+	{"plotLine", "pixel", {8, 64, 512}, setupMicroPlotLine, NULL, runMicroPlotLine},
+	{"plotLineWidth", "pixel", {8, 64, 512}, setupMicroPlotLineWidth, NULL, runMicroPlotLineWidth},
+	{"plotCircle", "pixel", {8, 64, 512}, setupMicroPlotCircle, NULL, runMicroPlotCircle},
+	{"fillPolygon", "pixel", {8, 64, 512}, setupMicroFillPolygon, NULL, runMicroFillPolygon},
+	{"fillPolygonPattern", "pixel", {8, 64, 512}, setupMicroFillPattern, NULL, runMicroFillPattern},
+	{"fillPolygonAA", "pixel", {8, 64, 512}, setupMicroFillAA, NULL, runMicroFillAA},
+	{"colorFlood", "pixel", {8, 64, 512}, setupMicroColorFlood, prepareMicroColorFlood, runMicroColorFlood},
+	{"intersectionGenerator", "row", {16, 128, 1024}, setupMicroIntersections, NULL, runMicroIntersections},
+	{"flushFrame", "pixel", {320, 1366, 1920}, setupMicroFrame, NULL, runMicroFlushFrame},
+	{"showFrame", "pixel", {320, 1366, 1920}, setupMicroFrame, NULL, runMicroShowFrame},
+};
+
+// best of runs; the workload is rebuilt from the same seed for every size, so results compare across builds
+MicroResult runMicroBench(const MicroBench* bench, int size, int runs) {
+	MicroWorkload* w = new MicroWorkload;
+	memset(&w->frm, 0, sizeof(w->frm));
+	w->fb.ptr = NULL;
+	w->size = size;
+	microSeed = 12345;
+	MicroResult result;
+	snprintf(result.name, sizeof(result.name), "%s", bench->name);
+	snprintf(result.size, sizeof(result.size), "%d", size);
+	result.unit = bench->unit;
+	result.units = bench->setup(w, size);
+	result.ns = 0;
+	for (int run = 0; run < runs; run++) {
+		if (bench->prepare) bench->prepare(w);
+		long long start = nowNs();
+		bench->run(w);
+		long long spent = nowNs() - start;
+		if (!run || spent < result.ns) result.ns = spent;
+	}
+	if (w->frm.px) freeFrame(&w->frm);
+	free(w->fb.ptr);
+	delete w;
+	return result;
+}
+
+// one result of a JSON file written by writeMicroJson
+typedef struct s_microBaseline {
+	char name[32];
+	char size[16];
+	double nsPerUnit;
+} MicroBaseline;
+
+// every result in a JSON file written by writeMicroJson; 0 if it can't be read
+int readMicroBaseline(const char* path, vector<MicroBaseline>* baseline) {
+	FILE* f = fopen(path, "r");
+	if (!f) return 0;
+	char line[256];
+	MicroBaseline b;
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, " {\"name\": \"%31[^\"]\", \"size\": \"%15[^\"]\", %*[^,], %*[^,], %*[^,], \"ns_per_unit\": %lf",
+				b.name, b.size, &b.nsPerUnit) == 3) {
+			baseline->push_back(b);
 		}
-		
-		plotLine(frame, x0, y0, x1, y1, color);
 	}
-	
-	// Pattern's coordinate
-	vector<Coord> patternCoordinates = getBirdCoordinate(coord(50,-10));
-	
+	fclose(f);
+	return 1;
 }
 
-void drawBird(Frame* frm, Coord loc,RGB color){
-	plotHalfCircle(frm,loc.x,loc.y,10,color);
-	plotHalfCircle(frm,loc.x+20,loc.y,10,color);
-	plotHalfCircle(frm,loc.x,loc.y,5,color);
-	plotHalfCircle(frm,loc.x+20,loc.y,5,color);
-	plotLine(frm,loc.x+10,loc.y,loc.x+5,loc.y,color);
-	plotLine(frm,loc.x-10,loc.y,loc.x-5,loc.y,color);
-	plotLine(frm,loc.x+15,loc.y,loc.x+10,loc.y,color);
-	plotLine(frm,loc.x+25,loc.y,loc.x+30,loc.y,color);
+// ns per unit of the baseline's result for r, -1 if it isn't there
+double baselineNsPerUnit(const vector<MicroBaseline>& baseline, const MicroResult* r) {
+	for (size_t i = 0; i < baseline.size(); i++) {
+		if (!strcmp(baseline[i].name, r->name) && !strcmp(baseline[i].size, r->size)) return baseline[i].nsPerUnit;
 	}
+	return -1;
+}
 
-void drawExplosion(Frame *frame, Coord loc, int mult, RGB color){	
-	plotLine(frame,loc.x+10*mult,loc.y +10*mult,loc.x+20*mult,loc.y+20*mult,color);
-	plotLine(frame,loc.x-10*mult,loc.y -10*mult,loc.x-20*mult,loc.y-20*mult,color);
-	plotLine(frame,loc.x+10*mult,loc.y -10*mult,loc.x+20*mult,loc.y-20*mult,color);
-	plotLine(frame,loc.x-10*mult,loc.y +10*mult,loc.x-20*mult,loc.y+20*mult,color);
-	plotLine(frame,loc.x,loc.y -10*mult,loc.x,loc.y-20*mult,color);
-	plotLine(frame,loc.x-10*mult,loc.y,loc.x-20*mult,loc.y,color);
-	plotLine(frame,loc.x+10*mult,loc.y ,loc.x+20*mult,loc.y,color);
-	plotLine(frame,loc.x,loc.y +10*mult,loc.x,loc.y+20*mult,color);
+void writeMicroJson(FILE* f, const vector<MicroResult>& results) {
+	fprintf(f, "{\"benchmarks\": [\n");
+	for (size_t i = 0; i < results.size(); i++) {
+		const MicroResult* r = &results[i];
+		fprintf(f, "  {\"name\": \"%s\", \"size\": \"%s\", \"unit\": \"%s\", \"units\": %lld, \"ns\": %lld, \"ns_per_unit\": %.4f, \"units_per_second\": %.0f}%s\n",
+			r->name, r->size, r->unit, r->units, r->ns, (double)r->ns / r->units, r->units * 1e9 / r->ns, i + 1 < results.size() ? "," : "");
+	}
+	fprintf(f, "]}\n");
 }
 
-void animateExplosion(Frame* frame, int explosionMul, Coord loc){
-	int explosionR, explosionG, explosionB;
-	explosionR = explosionG = explosionB = 255-explosionMul*12;	
-	if(explosionR <= 0 || explosionG <= 0 || explosionB <= 0){
-		explosionR = explosionG = explosionB = 0;
+/* --bench-primitives [--runs N] [--json FILE] [--baseline FILE] [--threshold PCT]:
+ * every primitive at every size. With a baseline, anything more than
+ * threshold percent slower per unit is flagged and the exit status is 1.
+ * With --json - the JSON goes to stdout and the table to stderr.
+ */
+int benchPrimitives(int argc, char** argv) {
+	int runs = 7;
+	const char* jsonPath = NULL;
+	const char* baselinePath = NULL;
+	double threshold = 10;
+	for (int i = 2; i < argc; i++) {
+		if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+			runs = atoi(argv[++i]);
+			if (runs < 1) runs = 1;
+		} else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+			jsonPath = argv[++i];
+		} else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+			baselinePath = argv[++i];
+		} else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+			threshold = atof(argv[++i]);
+		} else {
+			printf("Error: unknown option %s.\n", argv[i]);
+			return 6;
+		}
 	}
-	drawExplosion(frame, loc, explosionMul, rgb(explosionR, 0, 0));
+	vector<MicroBaseline> baseline;
+	if (baselinePath && !readMicroBaseline(baselinePath, &baseline)) {
+		printf("Error: cannot read baseline %s.\n", baselinePath);
+		return 1;
+	}
+	if (baselinePath && baseline.empty()) {
+		printf("Error: no results in baseline %s.\n", baselinePath);
+		return 1;
+	}
+	FILE* out = jsonPath && !strcmp(jsonPath, "-") ? stderr : stdout; // the table
+
+	vector<MicroResult> results;
+	int regressions = 0;
+	fprintf(out, "primitives, best of %d runs%s\n", runs, baselinePath ? ", against the baseline" : "");
+	fprintf(out, "  %-22s %6s %12s %12s %14s\n", "", "size", "units", "ns/unit", "units/s");
+	for (int b = 0; b < countOf(microBenches); b++) {
+		for (int k = 0; k < 3; k++) {
+			MicroResult r = runMicroBench(&microBenches[b], microBenches[b].sizes[k], runs);
+			results.push_back(r);
+			double nsPerUnit = (double)r.ns / r.units;
+			fprintf(out, "  %-22s %6s %12lld %9.3f ns %9.1f M %s/s", r.name, r.size, r.units, nsPerUnit, r.units * 1e3 / r.ns, r.unit);
+			double base = baselinePath ? baselineNsPerUnit(baseline, &r) : -1;
+			if (base > 0) {
+				double change = 100.0 * (nsPerUnit - base) / base;
+				int regressed = change > threshold;
+				regressions += regressed;
+				fprintf(out, "  %+6.1f%%%s", change, regressed ? "  REGRESSION" : "");
+			} else if (baselinePath) {
+				fprintf(out, "  (not in baseline)");
+			}
+			fprintf(out, "\n");
+		}
+	}
+
+	if (jsonPath) {
+		FILE* f = strcmp(jsonPath, "-") ? fopen(jsonPath, "w") : stdout;
+		if (!f) {
+			printf("Error: cannot write %s.\n", jsonPath);
+			return 1;
+		}
+		writeMicroJson(f, results);
+		if (f != stdout) fclose(f);
+	}
+	if (baselinePath) fprintf(out, "  %d regression(s) over %.0f%%\n", regressions, threshold);
+	return regressions ? 1 : 0;
 }
 
-void drawBomb(Frame *frame, Coord center, RGB color)
-{
-	int panjangBomb = 10;
-	//DrawKiri
-	plotLine(frame, center.x - 3, center.y + panjangBomb / 2, center.x -3, center.y - panjangBomb / 2, color); 
-	
-	//DrawKanan
-	plotLine(frame, center.x + 3, center.y + panjangBomb / 2, center.x + 3, center.y - panjangBomb / 2, color);
-	
-	//DrawAtas
-	plotLine(frame, center.x - 3, center.y - panjangBomb / 2, center.x +3, center.y - panjangBomb / 2, color);
-	
-	//DrawUjungKiri
-	plotLine(frame, center.x - 3, center.y + panjangBomb / 2, center.x, center.y + (panjangBomb / 2 + 4), color);
-	
-	//DrawUjungKanan
-	plotLine(frame, center.x + 3, center.y + panjangBomb / 2, center.x, center.y + (panjangBomb / 2 + 4), color);
+// --bench N: N deterministic game frames into the chosen backend, timed per frame
+int benchGameLoop(Backend* backend, int frames, int threads, int pipelined, int indexed) {
+	Game game;
+	initGame(&game);
+	Renderer* renderer = new Renderer;
+	initRenderer(renderer, backend, &game, threads, pipelined, indexed);
+
+	vector<long long> frameNs(frames);
+	int i;
+	long long runStart = nowNs();
+	for (i = 0; i < frames; i++) {
+		long long start = nowNs();
+		updateGame(&game);
+		renderFrame(renderer, &game, 0);
+		frameNs[i] = nowNs() - start;
+	}
+	finishFrames(renderer);
+	long long runNs = nowNs() - runStart;
+	sort(frameNs.begin(), frameNs.end());
+
+	printf("game loop, %d frames, %d band(s), %s, %s canvas, %s backend (%d bpp, line length %d, %d page(s))\n", frames, renderer->bands,
+		pipelined ? "pipelined" : "not pipelined", indexed ? "indexed" : "BGRX", backend->name, backend->fb.bpp, backend->fb.lineLen, backend->pages);
+	printf("  min    %8.1f us\n", frameNs[0] / 1000.0);
+	printf("  median %8.1f us\n", frameNs[frames / 2] / 1000.0);
+	printf("  p99    %8.1f us\n", frameNs[(frames - 1) * 99 / 100] / 1000.0);
+	printf("  sustained %.0f frames/s\n", frames * 1e9 / runNs);
+	printf("  final frame checksum %016lx\n", frameChecksum(&renderer->cFrame));
+	printRendererStats(renderer, "  ");
+	printSurfaceStats("  ");
+
+	freeRenderer(renderer);
+	delete renderer;
+	freeGame(&game);
+	return 0;
 }
 
 /* MAIN FUNCTION ------------------------------------------------------- */
-int main() {	
-	/* Preparations ---------------------------------------------------- */
-	
-	// get fb and screenInfos
-	struct fb_var_screeninfo vInfo; // variable screen info
-	struct fb_fix_screeninfo sInfo; // static screen info
-	int fbFile;	 // frame buffer file descriptor
-	fbFile = open("/dev/fb0",O_RDWR);
-	if (!fbFile) {
-		printf("Error: cannot open framebuffer device.\n");
-		exit(1);
+
+// set by Ctrl-C, so the main loop can end and clean up
+volatile sig_atomic_t quitRequested = 0;
+
+void requestQuit(int /*sig*/) {
+	quitRequested = 1;
+}
+
+int main(int argc, char** argv) {
+	/* Benchmark modes (no framebuffer needed) ------------------------- */
+	if (argc > 1 && strcmp(argv[1], "--bench-flood") == 0) {
+		return benchFlood(argc > 2 ? atoi(argv[2]) : 200);
 	}
-	if (ioctl (fbFile, FBIOGET_FSCREENINFO, &sInfo)) {
-		printf("Error reading fixed information.\n");
-		exit(2);
+	if (argc > 1 && strcmp(argv[1], "--bench-kernels") == 0) {
+		return benchKernels(argc > 2 ? atoi(argv[2]) : 200);
 	}
-	if (ioctl (fbFile, FBIOGET_VSCREENINFO, &vInfo)) {
-		printf("Error reading variable information.\n");
-		exit(3);
+	if (argc > 1 && strcmp(argv[1], "--bench-lines") == 0) {
+		return benchLines(argc > 2 ? atoi(argv[2]) : 1000000);
+	}
+	if (argc > 1 && strcmp(argv[1], "--bench-projectiles") == 0) {
+		return benchProjectiles(argc > 2 ? atoi(argv[2]) : 50000);
+	}
+	if (argc > 1 && strcmp(argv[1], "--bench-collisions") == 0) {
+		return benchCollisions(argc > 2 ? atoi(argv[2]) : 20);
+	}
+	if (argc > 1 && strcmp(argv[1], "--bench-input") == 0) {
+		return benchInput(argc > 2 ? atoi(argv[2]) : 1000);
+	}
+	if (argc > 1 && strcmp(argv[1], "--bench-surfaces") == 0) {
+		return benchSurfaces(argc > 2 ? atoi(argv[2]) : 200);
+	}
+	if (argc > 1 && strcmp(argv[1], "--bench-commands") == 0) {
+		return benchCommands(argc > 2 ? atoi(argv[2]) : 100000);
+	}
+	if (argc > 1 && strcmp(argv[1], "--bench-primitives") == 0) {
+		return benchPrimitives(argc, argv);
 	}
 	
-	// create the FrameBuffer struct with its important infos.
-	FrameBuffer fb;
-	fb.smemLen = sInfo.smem_len;
-	fb.lineLen = sInfo.line_length;
-	fb.bpp = vInfo.bits_per_pixel;
+	/* Options --------------------------------------------------------- */
+	const char* backendName = NULL;
+	const char* fbPath = NULL;
+	int bpp = 32;
+	int lineLen = 0;
+	int benchFrames = 0;
+	int threads = thread::hardware_concurrency();
+	int fps = simulationHz;
+	int vsync = 0;
+	int pipelined = 1;
+	int indexed = 0;
+	int pages = 1;
+#ifdef SHOOTER_TRACE
+	const char* tracePath = NULL;
+#endif
+	const char* mousePath = "/dev/input/mice";
+	int i;
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+			benchFrames = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+			backendName = argv[++i];
+		} else if (strcmp(argv[i], "--fb") == 0 && i + 1 < argc) {
+			fbPath = argv[++i];
+		} else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+			if (sscanf(argv[++i], "%dx%d", &screenX, &screenY) != 2 || screenX <= 0 || screenY <= 0) {
+				printf("Error: --size wants WIDTHxHEIGHT.\n");
+				exit(6);
+			}
+		} else if (strcmp(argv[i], "--bpp") == 0 && i + 1 < argc) {
+			bpp = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--line-length") == 0 && i + 1 < argc) {
+			lineLen = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+			fps = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--vsync") == 0) {
+			vsync = 1;
+		} else if (strcmp(argv[i], "--no-pipeline") == 0) {
+			pipelined = 0;
+		} else if (strcmp(argv[i], "--indexed") == 0) {
+			indexed = 1;
+		} else if (strcmp(argv[i], "--pages") == 0 && i + 1 < argc) {
+			pages = atoi(argv[++i]);
+			if (pages != 1 && pages != 2) {
+				printf("Error: --pages wants 1 or 2.\n");
+				exit(6);
+			}
+		} else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+#ifdef SHOOTER_TRACE
+			tracePath = argv[++i];
+#else
+			printf("Error: --trace needs a build with -DSHOOTER_TRACE.\n");
+			exit(6);
+#endif
+		} else if (strcmp(argv[i], "--mouse") == 0 && i + 1 < argc) {
+			mousePath = argv[++i];
+		} else {
+			printf("Error: unknown option %s.\n", argv[i]);
+			exit(6);
+		}
+	}
+	if (!backendName) backendName = benchFrames > 0 ? "memory" : "fbdev";
+	if (lineLen <= 0) lineLen = screenX * ((bpp + 7) / 8);
 	
-	// and map the framebuffer to the FB struct.
-	fb.ptr = (char*)mmap(0, sInfo.smem_len, PROT_READ | PROT_WRITE, MAP_SHARED, fbFile, 0);
-	if ((long int)fb.ptr == -1) {
-		printf ("Error: failed to map framebuffer device to memory.\n");
-		exit(4);
+	/* Preparations ---------------------------------------------------- */
+	
+	Backend backend;
+	if (strcmp(backendName, "fbdev") == 0) {
+		openFbdevBackend(&backend, fbPath ? fbPath : "/dev/fb0");
+	} else if (strcmp(backendName, "memory") == 0) {
+		openMemoryBackend(&backend, screenY, lineLen, bpp, pages);
+	} else if (strcmp(backendName, "file") == 0) {
+		openFileBackend(&backend, fbPath ? fbPath : "/tmp/shooter-fb.raw", screenY, lineLen, bpp, pages);
+	} else {
+		printf("Error: unknown backend %s.\n", backendName);
+		exit(6);
+	}
+	
+	if (benchFrames > 0) {
+		int status = benchGameLoop(&backend, benchFrames, threads, pipelined, indexed);
+#ifdef SHOOTER_TRACE
+		finishTrace(tracePath);
+#endif
+		backend.close(&backend);
+		return status;
 	}
 	
-	// prepare mouse controller
-	FILE *fmouse;
-	char mouseRaw[3];
-	fmouse = fopen("/dev/input/mice","r");
-	Coord mouse; // mouse internal counter
-	mouse.x = 0;
-	mouse.y = 0;
+	// prepare mouse controller, on its own thread so reading never stalls a frame
+	MouseInput* mouse = new MouseInput;
+	int hasMouse = startMouseInput(mouse, mousePath);
 		
 	// prepare environment controller
 	unsigned char loop = 1; // frame loop controller
-	Frame cFrame; // composition frame (Video RAM)
-	
-	// prepare canvas
-	Frame canvas;
-	flushFrame(&canvas, rgb(0,0,0));
-	int canvasWidth = 1000;
-	int canvasHeight = 500;
-	Coord canvasPosition = coord(screenX/2,screenY/2);
-		
-	// prepare ship
-	int shipVelocity = 5; // velocity (pixel/ loop)
-	int planeVelocity = 10;
-	
-	int shipXPosition = canvasWidth - 80;
-	int shipYPosition = 490;
-	int planeXPosition = canvasWidth;
-	int planeYPosition = 50;
-	int explosionMul = 0;
-	
-	// prepare ammunition
-	Coord firstAmmunitionCoordinate;
-	int isFirstAmmunitionReleased = 1;
-	Coord secondAmmunitionCoordinate;
-	int isSecondAmmunitionReleased = 0;
-	int ammunitionVelocity = 5;
-	int ammunitionLength = 20;
-	
-	firstAmmunitionCoordinate.x = shipXPosition;
-	firstAmmunitionCoordinate.y = shipYPosition - 120;
-	secondAmmunitionCoordinate.y = shipYPosition - 120;
-	
-	
-	//prepare Bomb
-	Coord firstBombCoordinate;
-	int isFirstBombReleased = 1;
-	Coord secondBombCoordinate;
-	int isSecondBombReleased = 0;
-	int bombVelocity = 10;
-	int bombLength = 20;
-	
-	firstBombCoordinate.x = planeXPosition;
-	firstBombCoordinate.y = planeYPosition + 120;
-	secondBombCoordinate.y = planeYPosition - 120;
-	
-	
-	int i; //for drawing.
-	int MoveLeft = 1;
-	int stickmanCounter = 0;
-	
-	int isXploded = 0;
-	Coord coordXplosion;
+	Game game;
+	initGame(&game);
+	Renderer* renderer = new Renderer;
+	initRenderer(renderer, &backend, &game, threads, pipelined, indexed);
+	if (hasMouse) renderer->input = mouse; // pipelined, the present thread closes the latency window
 	
 	/* Main Loop ------------------------------------------------------- */
 	
-	while (loop) {
-		
-		// clean composition frame
-		flushFrame(&cFrame, rgb(33,33,33));
-				
-		showCanvas(&cFrame, &canvas, canvasWidth, canvasHeight, canvasPosition, rgb(99,99,99), 1);
-		
-		// clean canvas
-		flushFrame(&canvas, rgb(0,0,0));
-		
-		// draw ship
-		drawShip(&canvas, coord(shipXPosition,shipYPosition), rgb(99,99,99));
-		colorFlood(&canvas,shipXPosition,shipYPosition-1,rgb(99,99,99));
-		
-		//drawFish
-		drawFish(&canvas, coord(shipXPosition + 20, shipYPosition), rgb(87, 255, 92));
-		colorFlood(&canvas, shipXPosition + 20, shipYPosition - 25,rgb(87, 255, 92));
-		drawFish(&canvas, coord(shipXPosition - 20, shipYPosition), rgb(87, 255, 92));
-		colorFlood(&canvas, shipXPosition - 20, shipYPosition - 25,rgb(87, 255, 92));
-		//colorFlood(&canvas, shipXPosition+22, shipYPosition - 24,rgb(87, 255, 92));
-
-		// draw stickman and cannon
-		drawStickmanAndCannon(&canvas, coord(shipXPosition,shipYPosition), rgb(99,99,99), stickmanCounter++);
-				
-		// draw plane
-		drawPlane(&canvas, coord(planeXPosition -= planeVelocity, planeYPosition), rgb(99, 99, 99));
-		
-		drawBird(&canvas,coord(planeXPosition+60,planeYPosition),rgb(99,99,99));
-		
-		colorFlood(&canvas,planeXPosition+59,planeYPosition,rgb(99,99,99));
-		
-		// Plane Bomb
-		if(isFirstBombReleased){
-			firstBombCoordinate.y+=bombVelocity;
-			
-			if(firstBombCoordinate.y >= 2 * canvasHeight/3 && !isSecondBombReleased){
-				isSecondBombReleased = 1;
-				secondBombCoordinate.x = planeXPosition;
-				secondBombCoordinate.y = planeYPosition + 15;
-			}
-			
-			if(firstBombCoordinate.y >= screenY - ((screenY - canvasHeight)/2)){
-				isFirstBombReleased = 0;
-			}
-			
-			drawBomb(&canvas, firstBombCoordinate, rgb(99, 99, 99));
-			drawAmmunition(&canvas, firstBombCoordinate, 3, ammunitionLength, rgb(99, 99, 99));
-		}
-		
-		if(isSecondBombReleased){
-			secondBombCoordinate.y+=bombVelocity;
-			
-			if(secondBombCoordinate.y >= canvasHeight/3 && !isFirstBombReleased){
-				isFirstBombReleased = 1;
-				firstBombCoordinate.x = planeXPosition;
-				firstBombCoordinate.y = planeYPosition + 15;
-			}
-			
-			if(secondBombCoordinate.y >= screenY - 150){
-				isSecondBombReleased = 0;
-			}
-			
-			drawBomb(&canvas, secondBombCoordinate, rgb(99, 99, 99));
-			drawAmmunition(&canvas, secondBombCoordinate, 3, ammunitionLength, rgb(99, 99, 99));
-		}
-		
-		// stickman ammunition
-		if(isFirstAmmunitionReleased){
-			firstAmmunitionCoordinate.y-=ammunitionVelocity;
-			
-			if(firstAmmunitionCoordinate.y <= canvasHeight/3 && !isSecondAmmunitionReleased){
-				isSecondAmmunitionReleased = 1;
-				secondAmmunitionCoordinate.x = shipXPosition;
-				secondAmmunitionCoordinate.y = shipYPosition - 120;
-			}
-			
-			if(firstAmmunitionCoordinate.y <= -ammunitionLength){
-				isFirstAmmunitionReleased = 0;
-			}
-			
-			drawPeluru(&canvas, firstAmmunitionCoordinate, rgb(99, 99, 99));
-			drawAmmunition(&canvas, firstAmmunitionCoordinate, 3, ammunitionLength, rgb(99, 99, 99));
-		}
-		
-		if(isSecondAmmunitionReleased){
-			secondAmmunitionCoordinate.y-=ammunitionVelocity;
-			
-			if(secondAmmunitionCoordinate.y <= canvasHeight/3 && !isFirstAmmunitionReleased){
-				isFirstAmmunitionReleased = 1;
-				firstAmmunitionCoordinate.x = shipXPosition;
-				firstAmmunitionCoordinate.y = shipYPosition - 120;
-			}
-			
-			if(secondAmmunitionCoordinate.y <= 0){
-				isSecondAmmunitionReleased = 0;
-			}
-			
-			drawPeluru(&canvas, secondAmmunitionCoordinate, rgb(99, 99, 99));
-			drawAmmunition(&canvas, secondAmmunitionCoordinate, 3, ammunitionLength, rgb(99, 99, 99));
-		}
-			
-		//explosion
-		if (isInBound(coord(firstAmmunitionCoordinate.x, firstAmmunitionCoordinate.y), coord(planeXPosition-5, planeYPosition-15), coord(planeXPosition+170, planeYPosition+15))) {
-			coordXplosion = firstAmmunitionCoordinate;
-			isXploded = 1;
-			//printf("boom");
-		} else if (isInBound(coord(secondAmmunitionCoordinate.x, secondAmmunitionCoordinate.y), coord(planeXPosition-5, planeYPosition-15), coord(planeXPosition+170, planeYPosition+15))) {
-			coordXplosion = secondAmmunitionCoordinate;
-			isXploded = 1;
-			//printf("boom");
-		}
-		else if (isInBound(coord(firstBombCoordinate.x, firstBombCoordinate.y), coord(shipXPosition-50, shipYPosition-100), coord(shipXPosition+50, shipYPosition+30))) {
-			coordXplosion = firstBombCoordinate;
-			isXploded = 1;
-			//printf("boom");
-		} else if (isInBound(coord(secondBombCoordinate.x, secondBombCoordinate.y), coord(shipXPosition-50, shipYPosition-100), coord(shipXPosition+50, shipYPosition+30))) {
-			coordXplosion = secondBombCoordinate;
-			isXploded = 1;
-			//printf("boom");
-		}
-		if (isXploded == 1) {
-			animateExplosion(&canvas, explosionMul, coordXplosion);
-			explosionMul++;
-			if(explosionMul >= 20){
-				explosionMul = 0;
-				isXploded = 0;
-			}
-		}
-		
-		if(planeXPosition <= -170){
-			planeXPosition = canvasWidth;
+	signal(SIGINT, requestQuit);
+	FramePacer pacer;
+	initFramePacer(&pacer, fps, vsync);
+	while (loop && !quitRequested) {
+		MouseState m;
+		if (hasMouse && pollMouseInput(mouse, &m)) {
+			game.cursorVisible = 1;
+			game.cursor = coord(m.cursor.x - (game.canvasPosition.x - game.canvasWidth/2), m.cursor.y - (game.canvasPosition.y - game.canvasHeight/2));
+			game.mouseButtons = m.buttons;
 		}
-		
-		if(planeXPosition == screenX/2 - canvasWidth/2 - 165){
-			planeXPosition = screenX/2 + canvasWidth/2;
-		}
-		
-		if(shipXPosition == 80){
-			MoveLeft = 0;
-		} 
-		
-		if(shipXPosition == canvasWidth - 80){
-			MoveLeft = 1;
-		} 
-		
-		if(MoveLeft){
-			shipXPosition -= shipVelocity;
-		}else{
-			shipXPosition += shipVelocity;
+
+		int ticks = dueTicks(&pacer);
+		for (i = 0; i < ticks; i++) updateGame(&game);
+		if (ticks) { // nothing moved, nothing to draw
+			long long inputNs = hasMouse ? takeUnshownInput(mouse) : 0;
+			renderFrame(renderer, &game, inputNs);
+			if (hasMouse && !pipelined) mouseInputPresented(mouse, inputNs);
 		}
-		
-		//show frame
-		showFrame(&cFrame,&fb);
-		
+		waitNextFrame(&pacer, &backend);
 	}
 
 	/* Cleanup --------------------------------------------------------- */
-	munmap(fb.ptr, sInfo.smem_len);
-	close(fbFile);
-	fclose(fmouse);
+	finishFrames(renderer);
+	printRendererStats(renderer, "");
+	if (hasMouse) {
+		printMouseInputStats(mouse);
+		stopMouseInput(mouse);
+	}
+	delete mouse;
+	freeRenderer(renderer);
+	delete renderer;
+	freeGame(&game);
+#ifdef SHOOTER_TRACE
+	finishTrace(tracePath);
+#endif
+	backend.close(&backend);
 	return 0;
 }